@@ -27,14 +27,35 @@
 #include "node-list.h"
 #include "net-device.h"
 #include "application.h"
+#include "stealth-header.h"
+#include "stealth-interest-set.h"
+#include "stealth-call-recorder.h"
+#include "stealth-state-digest.h"
+#include "stealth-memory-monitor.h"
+#include "stealth-metrics.h"
+#include "stealth-trust-matrix.h"
 #include "ns3/packet.h"
+#include "ns3/socket.h"
 #include "ns3/simulator.h"
 #include "ns3/object-vector.h"
 #include "ns3/uinteger.h"
 #include "ns3/log.h"
 #include "ns3/assert.h"
+#include "ns3/abort.h"
 #include "ns3/global-value.h"
 #include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/nstime.h"
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
 
 namespace ns3 {
 
@@ -42,6 +63,19 @@ NS_LOG_COMPONENT_DEFINE ("Node");
 
 NS_OBJECT_ENSURE_REGISTERED (Node);
 
+/**
+ * \brief Record a Stealth neighbor table call of this node while
+ * StealthCallRecorder is recording.
+ */
+#define STEALTH_RECORD(op, ...)                                         \
+  do                                                                    \
+    {                                                                   \
+      if (StealthCallRecorder::IsEnabled ())                            \
+        StealthCallRecorder::Record (StealthCallRecorder::op, m_id,     \
+                                     ##__VA_ARGS__);                    \
+    }                                                                   \
+  while (false)
+
 /**
  * \brief A global switch to enable all checksums for all protocols.
  */
@@ -79,13 +113,15 @@ Node::GetTypeId (void)
     .AddAttribute ("Status", "The status of this node: Emergency (true) or Normal (false).",
 				   TypeId::ATTR_GET | TypeId::ATTR_SET,
 				   BooleanValue (false),
-				   MakeBooleanAccessor (&Node::m_status),
+				   MakeBooleanAccessor (&Node::SetStatus,
+						   	   	   	   	&Node::GetStatus),
 				   MakeBooleanChecker ())
 	// Competence attribute
 	.AddAttribute ("Competence", "The health competence of this node.",
 				   TypeId::ATTR_GET | TypeId::ATTR_SET,
 				   StringValue ("other"),
-				   MakeStringAccessor (&Node::m_competence),
+				   MakeStringAccessor (&Node::SetCompetence,
+									   &Node::GetCompetence),
 				   MakeStringChecker ())
     // Service status attribute
 	.AddAttribute ("ServiceStatus", "The status of service to this node: Received (true) or Not received (false).",
@@ -99,13 +135,41 @@ Node::GetTypeId (void)
 				   UintegerValue (0),
 				   MakeUintegerAccessor (&Node::m_servicepriority),
 				   MakeUintegerChecker<uint8_t> ())
+    // Emergency duplicate suppression
+    .AddAttribute ("DuplicateWindow", "Time an emergency (origin, sequence) is remembered to drop its copies.",
+				   TimeValue (Seconds (10.0)),
+				   MakeTimeAccessor (&Node::m_duplicateWindow),
+				   MakeTimeChecker ())
+    .AddAttribute ("DuplicateCacheBits", "Size in bits of each emergency duplicate filter.",
+				   UintegerValue (4096),
+				   MakeUintegerAccessor (&Node::m_duplicateCacheBits),
+				   MakeUintegerChecker<uint32_t> (64))
+    // Emergency forwarding
+    .AddAttribute ("EmergencyHopLimit", "Maximum number of hops of an emergency toward a responder.",
+				   UintegerValue (4),
+				   MakeUintegerAccessor (&Node::m_emergencyHopLimit),
+				   MakeUintegerChecker<uint8_t> (1, StealthHeader::NO_ROUTE - 1))
+    // Trust gossip
+    .AddAttribute ("TrustGossipWeight", "Weight of the reputation gossiped by other nodes in the trust of a neighbor.",
+				   DoubleValue (0.0),
+				   MakeDoubleAccessor (&Node::m_trustGossipWeight),
+				   MakeDoubleChecker<double> (0.0, 1.0))
   ;
   return tid;
 }
 
 Node::Node()
   : m_id (0),
-    m_sid (0)
+    m_sid (0),
+    m_trustGossipWeight (0.0),
+    m_status (false),
+    m_competenceId (0),
+    m_competenceIdCached (false),
+    m_emergencySequence (0),
+    m_lastCheckedUid (0),
+    m_lastCheckedTime (Time::Min ()),
+    m_lastCheckedDuplicate (false),
+    m_active (true)
 {
   NS_LOG_FUNCTION (this);
   Construct ();
@@ -113,7 +177,16 @@ Node::Node()
 
 Node::Node(uint32_t sid)
   : m_id (0),
-    m_sid (sid)
+    m_sid (sid),
+    m_trustGossipWeight (0.0),
+    m_status (false),
+    m_competenceId (0),
+    m_competenceIdCached (false),
+    m_emergencySequence (0),
+    m_lastCheckedUid (0),
+    m_lastCheckedTime (Time::Min ()),
+    m_lastCheckedDuplicate (false),
+    m_active (true)
 { 
   NS_LOG_FUNCTION (this << sid);
   Construct ();
@@ -124,6 +197,8 @@ Node::Construct (void)
 {
   NS_LOG_FUNCTION (this);
   m_id = NodeList::Add (this);
+  m_interests = StealthInterestSet::Get (std::vector<std::string> ());
+  NotifyNeighborChange ();
 }
 
 Node::~Node ()
@@ -214,6 +289,8 @@ Node::DoDispose ()
   NS_LOG_FUNCTION (this);
   m_deviceAdditionListeners.clear ();
   m_handlers.clear ();
+  m_flushEvent.Cancel ();
+  m_pendingReceptions.clear ();
   for (std::vector<Ptr<NetDevice> >::iterator i = m_devices.begin ();
        i != m_devices.end (); i++)
     {
@@ -230,6 +307,7 @@ Node::DoDispose ()
       *i = 0;
     }
   m_applications.clear ();
+  ReleaseStealthState ();
   Object::DoDispose ();
 }
 
@@ -249,6 +327,7 @@ Node::DoInitialize (void)
       Ptr<Application> application = *i;
       application->Initialize ();
     }
+  m_duplicateCache.Configure (m_duplicateCacheBits, 3, m_duplicateWindow);
 
   Object::DoInitialize ();
 }
@@ -262,12 +341,57 @@ Node::RegisterProtocolHandler (ProtocolHandler handler,
   NS_LOG_FUNCTION (this << &handler << protocolType << device << promiscuous);
   struct Node::ProtocolHandlerEntry entry;
   entry.handler = handler;
+  entry.fastHandler = 0;
+  entry.context = 0;
+  entry.protocol = protocolType;
+  entry.device = device;
+  entry.promiscuous = promiscuous;
+  AddProtocolHandler (entry);
+}
+
+void
+Node::RegisterFastProtocolHandler (FastProtocolHandler handler,
+                                   void *context,
+                                   uint16_t protocolType,
+                                   Ptr<NetDevice> device,
+                                   bool promiscuous)
+{
+  NS_LOG_FUNCTION (this << &handler << context << protocolType << device << promiscuous);
+  NS_ASSERT_MSG (handler != 0, "Null fast protocol handler");
+  struct Node::ProtocolHandlerEntry entry;
+  entry.fastHandler = handler;
+  entry.context = context;
+  entry.protocol = protocolType;
+  entry.device = device;
+  entry.promiscuous = promiscuous;
+  AddProtocolHandler (entry);
+}
+
+void
+Node::RegisterBatchProtocolHandler (BatchProtocolHandler handler,
+                                    uint16_t protocolType,
+                                    Ptr<NetDevice> device,
+                                    bool promiscuous)
+{
+  NS_LOG_FUNCTION (this << &handler << protocolType << device << promiscuous);
+  struct Node::ProtocolHandlerEntry entry;
+  entry.batchHandler = handler;
+  entry.fastHandler = 0;
+  entry.context = 0;
   entry.protocol = protocolType;
   entry.device = device;
   entry.promiscuous = promiscuous;
+  AddProtocolHandler (entry);
+}
+
+void
+Node::AddProtocolHandler (const ProtocolHandlerEntry &entry)
+{
+  NS_LOG_FUNCTION (this);
+  Ptr<NetDevice> device = entry.device;
 
   // On demand enable promiscuous mode in netdevices
-  if (promiscuous)
+  if (entry.promiscuous)
     {
       if (device == 0)
         {
@@ -294,7 +418,37 @@ Node::UnregisterProtocolHandler (ProtocolHandler handler)
   for (ProtocolHandlerList::iterator i = m_handlers.begin ();
        i != m_handlers.end (); i++)
     {
-      if (i->handler.IsEqual (handler))
+      if (i->fastHandler == 0 && i->batchHandler.IsNull () && i->handler.IsEqual (handler))
+        {
+          m_handlers.erase (i);
+          break;
+        }
+    }
+}
+
+void
+Node::UnregisterFastProtocolHandler (FastProtocolHandler handler, void *context)
+{
+  NS_LOG_FUNCTION (this << &handler << context);
+  for (ProtocolHandlerList::iterator i = m_handlers.begin ();
+       i != m_handlers.end (); i++)
+    {
+      if (i->fastHandler == handler && i->context == context)
+        {
+          m_handlers.erase (i);
+          break;
+        }
+    }
+}
+
+void
+Node::UnregisterBatchProtocolHandler (BatchProtocolHandler handler)
+{
+  NS_LOG_FUNCTION (this << &handler);
+  for (ProtocolHandlerList::iterator i = m_handlers.begin ();
+       i != m_handlers.end (); i++)
+    {
+      if (!i->batchHandler.IsNull () && i->batchHandler.IsEqual (handler))
         {
           m_handlers.erase (i);
           break;
@@ -338,7 +492,18 @@ Node::ReceiveFromDevice (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16
   NS_LOG_DEBUG ("Node " << GetId () << " ReceiveFromDevice:  dev "
                         << device->GetIfIndex () << " (type=" << device->GetInstanceTypeId ().GetName ()
                         << ") Packet UID " << packet->GetUid ());
+  if (!m_active)
+    {
+      NS_LOG_DEBUG ("Node " << GetId () << " dormant, dropping packet UID " << packet->GetUid ());
+      return false;
+    }
+  if (IsDuplicateEmergency (packet))
+    {
+      NS_LOG_DEBUG ("Node " << GetId () << " dropping duplicate emergency, packet UID " << packet->GetUid ());
+      return false;
+    }
   bool found = false;
+  bool batch = false;
 
   for (ProtocolHandlerList::iterator i = m_handlers.begin ();
        i != m_handlers.end (); i++)
@@ -351,15 +516,200 @@ Node::ReceiveFromDevice (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16
             {
               if (promiscuous == i->promiscuous)
                 {
-                  i->handler (device, packet, protocol, from, to, packetType);
+                  if (i->fastHandler != 0)
+                    {
+                      i->fastHandler (i->context, PeekPointer (device), PeekPointer (packet),
+                                      protocol, from, to, packetType);
+                    }
+                  else if (!i->batchHandler.IsNull ())
+                    {
+                      batch = true;
+                    }
+                  else
+                    {
+                      i->handler (device, packet, protocol, from, to, packetType);
+                    }
                   found = true;
                 }
             }
         }
     }
+  if (batch)
+    {
+      // batch handlers get the packets of this instant at once
+      PendingReception reception;
+      reception.device = device;
+      reception.packet.packet = packet;
+      reception.packet.protocol = protocol;
+      reception.packet.from = from;
+      reception.packet.to = to;
+      reception.packet.packetType = packetType;
+      reception.promiscuous = promiscuous;
+      m_pendingReceptions.push_back (reception);
+      if (!m_flushEvent.IsRunning ())
+        {
+          m_flushEvent = Simulator::ScheduleNow (&Node::FlushReceptions, this);
+        }
+    }
   return found;
 }
 
+void
+Node::FlushReceptions (void)
+{
+  NS_LOG_FUNCTION (this << m_pendingReceptions.size ());
+  // borrow the storage, in case a handler receives again
+  std::vector<PendingReception> pending;
+  pending.swap (m_pendingReceptions);
+  std::vector<ReceivedPacket> burst;
+  burst.swap (m_burst);
+  for (uint32_t first = 0; m_active && first < pending.size (); first++)
+    {
+      // one burst per device and mode, in order of first reception
+      Ptr<NetDevice> device = pending[first].device;
+      bool promiscuous = pending[first].promiscuous;
+      bool seen = false;
+      for (uint32_t k = 0; k < first && !seen; k++)
+        {
+          seen = pending[k].device == device && pending[k].promiscuous == promiscuous;
+        }
+      if (seen)
+        {
+          continue;
+        }
+      for (ProtocolHandlerList::iterator i = m_handlers.begin ();
+           i != m_handlers.end (); i++)
+        {
+          if (i->batchHandler.IsNull () || (i->device != 0 && i->device != device)
+              || i->promiscuous != promiscuous)
+            {
+              continue;
+            }
+          burst.clear ();
+          for (uint32_t k = first; k < pending.size (); k++)
+            {
+              if (pending[k].device == device && pending[k].promiscuous == promiscuous
+                  && (i->protocol == 0 || i->protocol == pending[k].packet.protocol))
+                {
+                  burst.push_back (pending[k].packet);
+                }
+            }
+          if (!burst.empty ())
+            {
+              i->batchHandler (device, burst);
+            }
+        }
+    }
+  burst.clear ();
+  burst.swap (m_burst);
+  pending.clear ();
+  if (m_pendingReceptions.empty ())
+    {
+      pending.swap (m_pendingReceptions);
+    }
+}
+
+uint32_t
+Node::ReceiveBurstFromDevice (Ptr<NetDevice> device, const std::vector<ReceivedPacket> &packets,
+                              bool promiscuous)
+{
+  NS_LOG_FUNCTION (this << device << packets.size () << promiscuous);
+  NS_ASSERT_MSG (Simulator::GetContext () == GetId (), "Received packet with erroneous context ; " <<
+                 "make sure the channels in use are correctly updating events context " <<
+                 "when transfering events from one node to another.");
+  NS_LOG_DEBUG ("Node " << GetId () << " ReceiveBurstFromDevice:  dev "
+                        << device->GetIfIndex () << " " << packets.size () << " packets");
+  if (!m_active)
+    {
+      NS_LOG_DEBUG ("Node " << GetId () << " dormant, dropping " << packets.size () << " packets");
+      return 0;
+    }
+
+  std::vector<uint32_t> accepted;
+  accepted.reserve (packets.size ());
+  for (uint32_t k = 0; k < packets.size (); k++)
+    {
+      if (IsDuplicateEmergency (packets[k].packet))
+        {
+          NS_LOG_DEBUG ("Node " << GetId () << " dropping duplicate emergency, packet UID "
+                                << packets[k].packet->GetUid ());
+          continue;
+        }
+      accepted.push_back (k);
+    }
+
+  std::vector<bool> delivered (packets.size (), false);
+  std::vector<ReceivedPacket> burst;
+  for (ProtocolHandlerList::iterator i = m_handlers.begin ();
+       i != m_handlers.end (); i++)
+    {
+      if ((i->device != 0 && i->device != device) || promiscuous != i->promiscuous)
+        {
+          continue;
+        }
+      if (!i->batchHandler.IsNull () && i->protocol == 0 && accepted.size () == packets.size ())
+        {
+          // the whole burst, without copy
+          if (!packets.empty ())
+            {
+              i->batchHandler (device, packets);
+              delivered.assign (packets.size (), true);
+            }
+          continue;
+        }
+      burst.clear ();
+      for (std::vector<uint32_t>::const_iterator k = accepted.begin (); k != accepted.end (); k++)
+        {
+          const ReceivedPacket &received = packets[*k];
+          if (i->protocol != 0 && i->protocol != received.protocol)
+            {
+              continue;
+            }
+          delivered[*k] = true;
+          if (i->fastHandler != 0)
+            {
+              i->fastHandler (i->context, PeekPointer (device), PeekPointer (received.packet),
+                              received.protocol, received.from, received.to, received.packetType);
+            }
+          else if (!i->batchHandler.IsNull ())
+            {
+              burst.push_back (received);
+            }
+          else
+            {
+              i->handler (device, received.packet, received.protocol, received.from, received.to,
+                          received.packetType);
+            }
+        }
+      if (!burst.empty ())
+        {
+          i->batchHandler (device, burst);
+        }
+    }
+  return std::count (delivered.begin (), delivered.end (), true);
+}
+
+bool
+Node::IsDuplicateEmergency (Ptr<const Packet> packet)
+{
+  NS_LOG_FUNCTION (this << packet);
+  StealthTag tag;
+  if (!packet->PeekPacketTag (tag))
+    {
+      return false;
+    }
+  // promiscuous and non-promiscuous receptions of the same packet
+  // must not count as two copies, but a relayed copy keeps the uid
+  // and arrives later
+  if (packet->GetUid () != m_lastCheckedUid || Simulator::Now () != m_lastCheckedTime)
+    {
+      m_lastCheckedUid = packet->GetUid ();
+      m_lastCheckedTime = Simulator::Now ();
+      m_lastCheckedDuplicate = m_duplicateCache.CheckAndInsert (tag.GetKey (), Simulator::Now ());
+    }
+  return m_lastCheckedDuplicate;
+}
+
 void 
 Node::RegisterDeviceAdditionListener (DeviceAdditionListener listener)
 {
@@ -418,12 +768,77 @@ Node::NotifyDeviceAdded (Ptr<NetDevice> device)
  */
 
 bool
-Node::GetStatus (void)
+Node::GetStatus (void) const
 {
   NS_LOG_FUNCTION (this);
   return m_status;
 }
 
+/* Verify if the node is present in the scenario. A dormant node,
+ * not arrived yet or already gone, drops every packet it receives
+ *
+ * Inputs: NIL
+ *
+ * Output:
+ * true:	Node is active
+ * false:	Node is dormant
+ */
+
+bool
+Node::IsActive (void)
+{
+  NS_LOG_FUNCTION (this);
+  return m_active;
+}
+
+
+/* Make the node enter or leave the scenario. A node becoming
+ * dormant forgets its neighbors, attendings and trust reports,
+ * so that it comes back, if ever, with a clean view of the crowd;
+ * its competence, interests and status are kept
+ *
+ * Inputs:
+ * active: true to activate the node, false to make it dormant
+ *
+ * Output: NIL
+ */
+
+void
+Node::SetActive (bool active)
+{
+  NS_LOG_FUNCTION (this << active);
+  if (m_active && !active)
+  {
+	  NeighborHandlerList ().swap (m_neighborList);
+	  std::vector<InterestKeyList> ().swap (m_interestIndex);
+	  AttendingHandlerList ().swap (m_attendingList);
+	  m_trustReports.Clear ();
+	  NotifyNeighborChange ();
+  }
+  m_active = active;
+}
+
+
+/* Set node's status, as the "Status" attribute, with no attribute
+ * or Config path lookup
+ *
+ * Inputs:
+ * status: Node's health status
+ * 		   Emergency: true
+ * 		   Normal:	  false
+ *
+ * Output: NIL
+ */
+
+void
+Node::SetStatus (bool status)
+{
+  NS_LOG_FUNCTION (this << status);
+  if (StealthMetrics::IsEnabled ())
+	  StealthMetrics::NotifyStatus (m_id, m_status, status);
+  m_status = status;
+}
+
 /* Get node's competence
  *
  * Inputs: NIL
@@ -433,7 +848,7 @@ Node::GetStatus (void)
  */
 
 std::string
-Node::GetCompetence (void)
+Node::GetCompetence (void) const
 {
   NS_LOG_FUNCTION (this);
   return m_competence;
@@ -453,6 +868,28 @@ Node::SetCompetence (std::string competence)
 {
   NS_LOG_FUNCTION (this);
   m_competence = competence;
+  m_competenceIdCached = false;
+}
+
+
+/* Get the interned id of node's competence, interned on first use
+ * so that ids keep the order competences are first used in
+ *
+ * Inputs: NIL
+ *
+ * Output:
+ * id: interned competence id
+ */
+
+uint8_t
+Node::GetCompetenceId (void)
+{
+  if (!m_competenceIdCached)
+  {
+	  m_competenceId = StealthHeader::GetCompetenceId (m_competence);
+	  m_competenceIdCached = true;
+  }
+  return m_competenceId;
 }
 
 //
@@ -490,7 +927,7 @@ void
 Node::SetInterests (std::vector<std::string> interests)
 {
 	NS_LOG_FUNCTION (this);
-	m_interests = interests;
+	m_interests = StealthInterestSet::Get (interests);
 }
 
 
@@ -533,7 +970,7 @@ Node::GetCriticalInfo(std::string competence)
 std::vector<std::string>
 Node::GetInterests()
 {
-	return m_interests;
+	return m_interests->GetInterests ();
 }
 
 
@@ -555,109 +992,513 @@ Node::RegisterNeighbor (Address ip,
                         double trust)
 {
 	NS_LOG_FUNCTION (this);
+	STEALTH_RECORD (REGISTER_NEIGHBOR, ip, StealthHeader::GetCompetenceId (competence), trust);
 	struct Node::Neighbor neighbor;
 
 	neighbor.ip = ip;
 	neighbor.competence = competence;
-	neighbor.interests = interests;
+	neighbor.interests = StealthInterestSet::Get (interests);
 	neighbor.trust = trust;
 	neighbor.around = true;
+	neighbor.competenceId = StealthHeader::GetCompetenceId (competence);
+	std::memset (neighbor.responderHops, StealthHeader::NO_ROUTE, StealthHeader::MAX_ROUTED_COMPETENCES);
+	neighbor.load = 0;
+	neighbor.node = NO_NODE;
 	m_neighborList.push_back (neighbor);
+	IndexInterests (ip, neighbor.interests);
+	NotifyNeighborChange ();
 }
 
 
-/* Get node's neighbors IP addresses
+/* Register one node as neighbor from a received StealthHeader.
+ * The header fields are read in place: competence and interests
+ * are resolved through the interned tables shared by all nodes.
  *
- * Inputs: NIL
+ * Inputs:
+ * ip: Neighbor's node IP address
+ * header: Hello header received from the neighbor
+ * trust: Neighbor's node calculated trust
  *
- * Output:
- * NeighborIpList: List with node's neighbor IP addresses
+ * Output: NIL
  */
 
-std::vector<Address>
-Node::GetNeighborIpList ()
+void
+Node::RegisterNeighbor (Address ip,
+                        const StealthHeader &header,
+                        double trust)
 {
-  NS_LOG_FUNCTION (this);
-  std::vector<Address> NeighborIpList;
-  for (NeighborHandlerList::iterator i = m_neighborList.begin ();
-       i != m_neighborList.end (); i++)
-    {
-		NeighborIpList.push_back(i->ip);
-    }
-  return NeighborIpList;
+	NS_LOG_FUNCTION (this);
+	STEALTH_RECORD (REGISTER_NEIGHBOR, ip, header.GetCompetence (), trust);
+	struct Node::Neighbor neighbor;
+
+	neighbor.ip = ip;
+	neighbor.competence = StealthHeader::GetCompetenceName (header.GetCompetence ());
+	neighbor.interests = StealthInterestSet::Get (header.GetInterests ());
+	neighbor.trust = trust;
+	neighbor.around = true;
+	neighbor.competenceId = header.GetCompetence ();
+	for (uint8_t c = 0; c < StealthHeader::MAX_ROUTED_COMPETENCES; c++)
+		neighbor.responderHops[c] = header.GetResponderHops (c);
+	neighbor.load = header.GetLoad ();
+	neighbor.node = header.GetOrigin ();
+	m_neighborList.push_back (neighbor);
+	IndexInterests (ip, neighbor.interests);
+	ReceiveTrustReports (header);
+	NotifyNeighborChange ();
 }
 
 
-/* Turn off live neighbors in the list. This permits
- * to refresh neighbor's list at every broadcast sent
+/* Refresh a neighbor from a received hello StealthHeader: confirms
+ * its presence and stores the responder distances it advertises
  *
- * Inputs: NIL
+ * Inputs:
+ * ip: Neighbor's node IP address
+ * header: Hello header received from the neighbor
  *
  * Output: NIL
  */
 
 void
-Node::TurnOffLiveNeighbors ()
+Node::UpdateNeighbor (Address ip, const StealthHeader &header)
 {
   NS_LOG_FUNCTION (this);
+  STEALTH_RECORD (UPDATE_NEIGHBOR, ip);
   for (NeighborHandlerList::iterator i = m_neighborList.begin ();
-       i != m_neighborList.end (); i++)
- 	  	  i->around = false;
- }
+      i != m_neighborList.end (); i++)
+	  	  if (i->ip == ip)
+	  	  {
+	  		  if (RefreshNeighbor (*i, header))
+	  			  NotifyNeighborChange ();
+	  		  break;
+	  	  }
+}
 
 
-/* Remove a node from nodes' neighbor list
+/* Store what a neighbor advertises in its hello
  *
  * Inputs:
- * ip: Neighbor IP address
+ * neighbor: Neighbor entry of the sender
+ * header: Hello header received from the neighbor
  *
- * Output: NIL
+ * Output:
+ * true:	the responder distances, node id or gossiped trust changed,
+ * 			so the emergency routes must be computed again
+ * false:	the routes still hold
  */
 
-void
-Node::UnregisterNeighbor (Address ip)
+bool
+Node::RefreshNeighbor (Neighbor &neighbor, const StealthHeader &header)
 {
-  NS_LOG_FUNCTION (this);
-  if (IsAlreadyNeighbor(ip)) // checks if is already a neighbor
-  	{
-	  for (NeighborHandlerList::iterator i = m_neighborList.begin ();
-       i != m_neighborList.end (); i++)
-	  	 {
-		  if (i->ip == ip)
-		  	  {
-			  m_neighborList.erase (i);
-			  break;
-		  	  }
-	  	 }
-  	}
+  bool changed = neighbor.node != header.GetOrigin ();
+  neighbor.around = true;
+  for (uint8_t c = 0; c < StealthHeader::MAX_ROUTED_COMPETENCES; c++)
+  {
+	  changed = changed || neighbor.responderHops[c] != header.GetResponderHops (c);
+	  neighbor.responderHops[c] = header.GetResponderHops (c);
+  }
+  neighbor.load = header.GetLoad ();
+  neighbor.node = header.GetOrigin ();
+  // reputations only weigh in the routes with a gossip weight
+  bool gossiped = ReceiveTrustReports (header);
+  return changed || (gossiped && m_trustGossipWeight > 0.0);
 }
 
 
-/* Remove neighbors that is not around a node
- * from its neighbors' list
+/* Process the hellos received during a time step at once: known
+ * senders are refreshed as by UpdateNeighbor and new ones registered
+ * as by RegisterNeighbor, with one lookup structure for the whole
+ * burst instead of a scan of the table per hello. A sender found
+ * twice is refreshed by its last hello.
  *
- * Inputs: NIL
+ * Inputs:
+ * hellos: Hellos received, in their order of reception
  *
  * Output: NIL
  */
 
 void
-Node::UnregisterOffNeighbors ()
+Node::ReceiveHellos (const std::vector<StealthHello> &hellos)
 {
-  NS_LOG_FUNCTION (this);
-  for (NeighborHandlerList::iterator i = m_neighborList.begin ();
-      i != m_neighborList.end (); )
-	  	  if (i->around == false)
-	  	  {
-	  		  m_neighborList.erase (i);
-	  	  }
-	  	  else
-	  		  ++i;
+  NS_LOG_FUNCTION (this << hellos.size ());
+  if (hellos.empty ())
+	  return;
+
+  // sorted view of the table, for a logarithmic lookup per hello
+  std::vector<std::pair<Address, uint32_t> > byIp (m_neighborList.size ());
+  for (uint32_t i = 0; i < m_neighborList.size (); i++)
+	  byIp[i] = std::make_pair (m_neighborList[i].ip, i);
+  std::sort (byIp.begin (), byIp.end ());
+
+  bool changed = false;
+  for (std::vector<StealthHello>::const_iterator h = hellos.begin (); h != hellos.end (); h++)
+  {
+	  std::vector<std::pair<Address, uint32_t> >::iterator it =
+			  std::lower_bound (byIp.begin (), byIp.end (), std::make_pair (h->ip, 0u));
+	  if (it != byIp.end () && it->first == h->ip)
+	  {
+		  STEALTH_RECORD (UPDATE_NEIGHBOR, h->ip);
+		  changed = RefreshNeighbor (m_neighborList[it->second], h->header) || changed;
+	  }
+	  else
+	  {
+		  // registration invalidates the routes
+		  byIp.insert (it, std::make_pair (h->ip, (uint32_t) m_neighborList.size ()));
+		  RegisterNeighbor (h->ip, h->header, h->trust);
+	  }
+  }
+  if (changed)
+	  NotifyNeighborChange ();
 }
 
 
-/* Confirm neighbor presence in the node neighbors' list
- *
+/* Work shared by the threads of UpdateNeighborTables. The contacts
+ * of node n are contacts[order[offsets[n]]] .. contacts[order[offsets[n+1]-1]],
+ * in their original order. Worker w owns nodes [next[w], end[w]);
+ * a worker done with its own range takes nodes from the others.
+ */
+
+struct Node::NeighborTableWork
+{
+  const std::vector<StealthContact> *contacts;	//!< contacts of the time step
+  std::vector<Node *> nodes;					//!< nodes, by id
+  std::vector<uint32_t> offsets;				//!< first contact of each node in order
+  std::vector<uint32_t> order;					//!< contact indices grouped by node
+  std::vector<std::vector<uint32_t> > pending;	//!< new peers of each node
+  std::vector<std::atomic<uint32_t> > next;		//!< next node of each worker range
+  std::vector<uint32_t> end;					//!< end of each worker range
+};
+
+
+/* Threads of UpdateNeighborTables, kept alive between time steps so
+ * that a step does not pay for creating and joining them. Each round
+ * runs job (w) on worker threads 1 .. n-1 and job (0) on the calling
+ * thread, and returns once all of them are done.
+ */
+
+class NeighborWorkerPool
+{
+public:
+  NeighborWorkerPool ()
+    : m_job (0),
+      m_nWorkers (0),
+      m_round (0),
+      m_running (0),
+      m_stop (false)
+  {
+  }
+
+  ~NeighborWorkerPool ()
+  {
+	{
+	  std::lock_guard<std::mutex> lock (m_mutex);
+	  m_stop = true;
+	}
+	m_start.notify_all ();
+	for (uint32_t t = 0; t < m_threads.size (); t++)
+	  m_threads[t].join ();
+  }
+
+  void Run (uint32_t nWorkers, const std::function<void (uint32_t)> &job)
+  {
+	{
+	  std::lock_guard<std::mutex> lock (m_mutex);
+	  while (m_threads.size () + 1 < nWorkers)
+		m_threads.push_back (std::thread (&NeighborWorkerPool::Loop, this, m_threads.size () + 1));
+	  m_job = &job;
+	  m_nWorkers = nWorkers;
+	  m_running = nWorkers - 1;
+	  m_round++;
+	}
+	m_start.notify_all ();
+	job (0);
+	std::unique_lock<std::mutex> lock (m_mutex);
+	while (m_running != 0)
+	  m_done.wait (lock);
+  }
+
+private:
+  void Loop (uint32_t worker)
+  {
+	uint64_t seen = 0;
+	std::unique_lock<std::mutex> lock (m_mutex);
+	for (;;)
+	{
+	  while (!m_stop && m_round == seen)
+		m_start.wait (lock);
+	  if (m_stop)
+		return;
+	  seen = m_round;
+	  if (worker >= m_nWorkers)
+		continue;
+	  const std::function<void (uint32_t)> *job = m_job;
+	  lock.unlock ();
+	  (*job) (worker);
+	  lock.lock ();
+	  if (--m_running == 0)
+		m_done.notify_one ();
+	}
+  }
+
+  std::vector<std::thread> m_threads;				//!< worker threads 1 .. size
+  std::mutex m_mutex;								//!< guards the fields below
+  std::condition_variable m_start;				//!< a round or the stop is posted
+  std::condition_variable m_done;					//!< the last worker of a round is done
+  const std::function<void (uint32_t)> *m_job;	//!< job of the current round
+  uint32_t m_nWorkers;							//!< workers of the current round, caller included
+  uint64_t m_round;								//!< rounds posted
+  uint32_t m_running;								//!< worker threads still busy in the round
+  bool m_stop;									//!< the pool is being destroyed
+};
+
+
+/* Update this node's neighbor table from the peers it sees during a
+ * time step: known peers are refreshed with their new trust, peers not
+ * seen anymore are removed and new peers are registered
+ *
+ * Inputs:
+ * contacts: peers seen by this node (the node field is ignored)
+ *
+ * Output: NIL
+ */
+
+void
+Node::UpdateNeighborTable (const std::vector<StealthContact> &contacts)
+{
+  NS_LOG_FUNCTION (this);
+  std::vector<uint32_t> indices (contacts.size ());
+  for (uint32_t i = 0; i < contacts.size (); i++)
+	  indices[i] = i;
+  std::vector<uint32_t> pending;
+  RefreshNeighbors (contacts, indices.empty () ? 0 : &indices[0], indices.size (), pending);
+  ApplyNeighborChanges (contacts, pending);
+}
+
+
+/* Update the neighbor tables of all nodes from the contacts of a
+ * time step, in parallel. Each node only depends on its own contacts,
+ * taken in their order in the list, so the outcome is the same for
+ * any number of threads.
+ *
+ * Refresh of known peers (presence and trust) runs on nThreads threads
+ * with work stealing, kept alive from one call to the next; pruning and
+ * registration, which share interest sets between nodes, run afterwards
+ * on the calling thread.
+ *
+ * Inputs:
+ * contacts: peers seen by each node of NodeList during the time step
+ * nThreads: number of threads, including the calling one
+ *
+ * Output: NIL
+ */
+
+void
+Node::UpdateNeighborTables (const std::vector<StealthContact> &contacts,
+                            uint32_t nThreads)
+{
+  NS_LOG_FUNCTION (contacts.size () << nThreads);
+  uint32_t nNodes = NodeList::GetNNodes ();
+  NeighborTableWork work;
+  work.contacts = &contacts;
+  work.nodes.resize (nNodes);
+  for (uint32_t n = 0; n < nNodes; n++)
+	  work.nodes[n] = PeekPointer (NodeList::GetNode (n));
+
+  // group contacts by node, keeping their order (counting sort)
+  work.offsets.assign (nNodes + 1, 0);
+  for (uint32_t i = 0; i < contacts.size (); i++)
+  {
+	  NS_ASSERT_MSG (contacts[i].node < nNodes, "Contact of unknown node " << contacts[i].node);
+	  work.offsets[contacts[i].node + 1]++;
+  }
+  for (uint32_t n = 0; n < nNodes; n++)
+	  work.offsets[n + 1] += work.offsets[n];
+  std::vector<uint32_t> fill (work.offsets.begin (), work.offsets.end () - 1);
+  work.order.resize (contacts.size ());
+  for (uint32_t i = 0; i < contacts.size (); i++)
+	  work.order[fill[contacts[i].node]++] = i;
+  work.pending.resize (nNodes);
+
+  nThreads = std::max (1u, std::min (nThreads, nNodes));
+  work.next = std::vector<std::atomic<uint32_t> > (nThreads);
+  work.end.resize (nThreads);
+  for (uint32_t w = 0; w < nThreads; w++)
+  {
+	  work.next[w].store ((uint64_t) nNodes * w / nThreads);
+	  work.end[w] = (uint64_t) nNodes * (w + 1) / nThreads;
+  }
+
+  static NeighborWorkerPool pool;
+  std::function<void (uint32_t)> job = std::bind (&Node::RunNeighborWorker, &work, std::placeholders::_1);
+  pool.Run (nThreads, job);
+
+  for (uint32_t n = 0; n < nNodes; n++)
+	  work.nodes[n]->ApplyNeighborChanges (contacts, work.pending[n]);
+}
+
+
+void
+Node::RunNeighborWorker (NeighborTableWork *work, uint32_t worker)
+{
+  uint32_t nWorkers = work->end.size ();
+  for (uint32_t k = 0; k < nWorkers; k++)
+  {
+	  // own range first, then the others
+	  uint32_t w = (worker + k) % nWorkers;
+	  for (;;)
+	  {
+		  uint32_t n = work->next[w].fetch_add (1);
+		  if (n >= work->end[w])
+			  break;
+		  uint32_t first = work->offsets[n];
+		  uint32_t count = work->offsets[n + 1] - first;
+		  work->nodes[n]->RefreshNeighbors (*work->contacts,
+				  count == 0 ? 0 : &work->order[first], count,
+				  work->pending[n]);
+	  }
+  }
+}
+
+
+/* Mark every peer of the node absent, then present again with its
+ * new trust if it is among the contacts. Contacts with unknown peers
+ * are left pending for ApplyNeighborChanges.
+ */
+
+void
+Node::RefreshNeighbors (const std::vector<StealthContact> &contacts,
+                        const uint32_t *indices, uint32_t count,
+                        std::vector<uint32_t> &pending)
+{
+  // sorted view of the table, for a logarithmic lookup per contact
+  std::vector<std::pair<Address, uint32_t> > byIp (m_neighborList.size ());
+  for (uint32_t i = 0; i < m_neighborList.size (); i++)
+  {
+	  m_neighborList[i].around = false;
+	  byIp[i] = std::make_pair (m_neighborList[i].ip, i);
+  }
+  std::sort (byIp.begin (), byIp.end ());
+
+  pending.clear ();
+  for (uint32_t k = 0; k < count; k++)
+  {
+	  const StealthContact &contact = contacts[indices[k]];
+	  std::vector<std::pair<Address, uint32_t> >::iterator it =
+			  std::lower_bound (byIp.begin (), byIp.end (), std::make_pair (contact.ip, 0u));
+	  if (it != byIp.end () && it->first == contact.ip)
+	  {
+		  m_neighborList[it->second].around = true;
+		  m_neighborList[it->second].trust = contact.trust;
+	  }
+	  else
+		  pending.push_back (indices[k]);
+  }
+}
+
+
+/* Remove the peers left absent by RefreshNeighbors and register
+ * the pending ones
+ */
+
+void
+Node::ApplyNeighborChanges (const std::vector<StealthContact> &contacts,
+                            const std::vector<uint32_t> &pending)
+{
+  NS_LOG_FUNCTION (this << pending.size ());
+  uint32_t kept = 0;
+  for (uint32_t i = 0; i < m_neighborList.size (); i++)
+	  if (m_neighborList[i].around)
+	  {
+		  if (kept != i)
+			  m_neighborList[kept] = m_neighborList[i];
+		  kept++;
+	  }
+	  else
+	  {
+		  UnindexInterests (m_neighborList[i].ip, m_neighborList[i].interests);
+		  if (m_neighborList[i].node != NO_NODE)
+			  m_trustReports.RemoveRow (m_neighborList[i].node);
+	  }
+  m_neighborList.resize (kept);
+
+  // pending peers are not in the table, but the same one may be seen
+  // twice: only its first contact is registered
+  std::vector<std::pair<Address, uint32_t> > byIp (pending.size ());
+  for (uint32_t k = 0; k < pending.size (); k++)
+	  byIp[k] = std::make_pair (contacts[pending[k]].ip, k);
+  std::sort (byIp.begin (), byIp.end ());
+  std::vector<bool> first (pending.size (), false);
+  for (uint32_t j = 0; j < byIp.size (); j++)
+	  if (j == 0 || byIp[j].first != byIp[j - 1].first)
+		  first[byIp[j].second] = true;
+
+  for (uint32_t k = 0; k < pending.size (); k++)
+  {
+	  const StealthContact &contact = contacts[pending[k]];
+	  if (!first[k])
+		  continue;
+	  struct Node::Neighbor neighbor;
+	  neighbor.ip = contact.ip;
+	  neighbor.competence = contact.competence;
+	  neighbor.interests = contact.interests != 0 ? contact.interests
+			  : StealthInterestSet::Get (std::vector<std::string> ());
+	  neighbor.trust = contact.trust;
+	  neighbor.around = true;
+	  neighbor.competenceId = StealthHeader::GetCompetenceId (contact.competence);
+	  std::memset (neighbor.responderHops, StealthHeader::NO_ROUTE, StealthHeader::MAX_ROUTED_COMPETENCES);
+	  neighbor.load = 0;
+	  neighbor.node = NO_NODE;
+	  m_neighborList.push_back (neighbor);
+	  IndexInterests (neighbor.ip, neighbor.interests);
+  }
+  // trusts changed too
+  NotifyNeighborChange ();
+}
+
+
+/* Get node's neighbors IP addresses
+ *
+ * Inputs: NIL
+ *
+ * Output:
+ * NeighborIpList: List with node's neighbor IP addresses
+ */
+
+std::vector<Address>
+Node::GetNeighborIpList ()
+{
+  NS_LOG_FUNCTION (this);
+  STEALTH_RECORD (GET_NEIGHBOR_IP_LIST);
+  std::vector<Address> NeighborIpList;
+  for (NeighborHandlerList::iterator i = m_neighborList.begin ();
+       i != m_neighborList.end (); i++)
+    {
+		NeighborIpList.push_back(i->ip);
+    }
+  return NeighborIpList;
+}
+
+
+/* Turn off live neighbors in the list. This permits
+ * to refresh neighbor's list at every broadcast sent
+ *
+ * Inputs: NIL
+ *
+ * Output: NIL
+ */
+
+void
+Node::TurnOffLiveNeighbors ()
+{
+  NS_LOG_FUNCTION (this);
+  STEALTH_RECORD (TURN_OFF_LIVE_NEIGHBORS);
+  for (NeighborHandlerList::iterator i = m_neighborList.begin ();
+       i != m_neighborList.end (); i++)
+ 	  	  i->around = false;
+ }
+
+
+/* Remove a node from nodes' neighbor list
+ *
  * Inputs:
  * ip: Neighbor IP address
  *
@@ -665,16 +1506,72 @@ Node::UnregisterOffNeighbors ()
  */
 
 void
-Node::TurnNeighborOn (Address ip)
+Node::UnregisterNeighbor (Address ip)
 {
   NS_LOG_FUNCTION (this);
+  STEALTH_RECORD (UNREGISTER_NEIGHBOR, ip);
+  // a single pass: the neighbor is removed only if found
   for (NeighborHandlerList::iterator i = m_neighborList.begin ();
-      i != m_neighborList.end (); i++)
-	  	  if (i->ip == ip)
+       i != m_neighborList.end (); i++)
+	  	 {
+		  if (i->ip == ip)
+		  	  {
+			  UnindexInterests (i->ip, i->interests);
+			  // the reports of a node are only kept while it is a neighbor
+			  if (i->node != NO_NODE)
+				  m_trustReports.RemoveRow (i->node);
+			  m_neighborList.erase (i);
+			  NotifyNeighborChange ();
+			  break;
+		  	  }
+	  	 }
+}
+
+
+/* Remove neighbors that is not around a node
+ * from its neighbors' list
+ *
+ * Inputs: NIL
+ *
+ * Output: NIL
+ */
+
+void
+Node::UnregisterOffNeighbors ()
+{
+  NS_LOG_FUNCTION (this);
+  STEALTH_RECORD (UNREGISTER_OFF_NEIGHBORS);
+  for (NeighborHandlerList::iterator i = m_neighborList.begin ();
+      i != m_neighborList.end (); )
+	  	  if (i->around == false)
 	  	  {
-	  		  i->around = true;
-	  		  break;
+	  		  UnindexInterests (i->ip, i->interests);
+	  		  if (i->node != NO_NODE)
+	  			  m_trustReports.RemoveRow (i->node);
+	  		  i = m_neighborList.erase (i);
+	  		  NotifyNeighborChange ();
 	  	  }
+	  	  else
+	  		  ++i;
+}
+
+
+/* Confirm neighbor presence in the node neighbors' list
+ *
+ * Inputs:
+ * ip: Neighbor IP address
+ *
+ * Output: NIL
+ */
+
+void
+Node::TurnNeighborOn (Address ip)
+{
+  NS_LOG_FUNCTION (this);
+  STEALTH_RECORD (TURN_NEIGHBOR_ON, ip);
+  uint32_t i = FindNeighborIndex (ip);
+  if (i < m_neighborList.size ())
+	  m_neighborList[i].around = true;
 }
 
 
@@ -690,248 +1587,1147 @@ Node::TurnNeighborOn (Address ip)
 bool
 Node::IsThereAnyNeighbor()
 {
-  NS_LOG_FUNCTION (this);
-  return !m_neighborList.empty();
+  NS_LOG_FUNCTION (this);
+  STEALTH_RECORD (IS_THERE_ANY_NEIGHBOR);
+  return !m_neighborList.empty();
+}
+
+
+/* Check node's neighbors' list for the node with the biggest trust
+ * based on competences used in simulation. They should be given in
+ * order of priority, from 0 to n.
+ * 06Nov18
+ *
+ * Do not check if neighbor list is empty. This must be done
+ * before through method Node::IsThereAnyNeighbor
+ *
+ * Inputs:
+ * competences: ompetences used in simulation
+ *
+ * Output:
+ * ip: IP address of the biggest trust neighbor node, or an
+ * 	   empty address if no neighbor has the competences
+ */
+
+Address
+Node::GetPlusTrustNeighbor (std::vector<std::string> competences)
+{
+  double trust = 0.0;
+  bool gotTrust = false;
+  NeighborHandlerList::iterator n;
+  NS_LOG_FUNCTION (this);
+  if (StealthCallRecorder::IsEnabled ())
+    {
+      std::vector<uint8_t> ids;
+      for (uint8_t i = 0; i != competences.size (); i++)
+        ids.push_back (StealthHeader::GetCompetenceId (competences[i]));
+      StealthCallRecorder::Record (StealthCallRecorder::GET_PLUS_TRUST_NEIGHBOR, m_id,
+                                   StealthCallRecorder::PackCompetences (ids));
+    }
+
+  // search for the biggest competence
+  for (uint8_t i = 0; i != competences.size(); i++ )
+  {
+	  // search for the biggest trust with that competence
+	  for (NeighborHandlerList::iterator it = m_neighborList.begin ();
+			  it != m_neighborList.end (); it++)
+	  {
+		  if (it->competence == competences[i])
+		  {
+			  double combined = GetCombinedTrust (*it);
+			  if (combined > trust)
+			  {
+				  trust = combined;
+				  n = it;
+				  gotTrust = true;
+			  }
+		  }
+	  }
+	  if (gotTrust)
+		  break;
+  }
+  return gotTrust ? n->ip : Address ();
+}
+
+
+/* Choose a responder among the neighbors with the competences used
+ * in simulation, given in order of priority, balancing the load:
+ * two neighbors with the first competence found are drawn at random
+ * and the one advertising the lower pending load is chosen, the most
+ * trusted on a tie. Unlike GetPlusTrustNeighbor, alerts are spread
+ * over equally capable responders instead of all going to the most
+ * trusted one.
+ *
+ * Inputs:
+ * competences: competences used in simulation
+ * responder: the chosen neighbor IP address
+ *
+ * Output:
+ * true:	A responder was found
+ * false:	No neighbor has any of the competences
+ */
+
+bool
+Node::GetBalancedNeighbor (std::vector<std::string> competences,
+                           Address &responder)
+{
+  NS_LOG_FUNCTION (this);
+  std::vector<uint32_t> candidates;
+  for (uint32_t c = 0; c < competences.size () && candidates.empty (); c++)
+	  for (uint32_t i = 0; i < m_neighborList.size (); i++)
+		  if (m_neighborList[i].competence == competences[c])
+			  candidates.push_back (i);
+  if (candidates.empty ())
+	  return false;
+
+  const Neighbor *chosen = &m_neighborList[candidates[0]];
+  if (candidates.size () > 1)
+  {
+	  // created on first use, so that nodes never balancing take no
+	  // stream from the other random variables of the scenario
+	  if (m_responderRng == 0)
+		  m_responderRng = CreateObject<UniformRandomVariable> ();
+	  uint32_t a = m_responderRng->GetInteger (0, candidates.size () - 1);
+	  uint32_t b = m_responderRng->GetInteger (0, candidates.size () - 2);
+	  if (b >= a)
+		  b++;
+	  const Neighbor &first = m_neighborList[candidates[a]];
+	  const Neighbor &second = m_neighborList[candidates[b]];
+	  if (first.load != second.load)
+		  chosen = first.load < second.load ? &first : &second;
+	  else
+		  chosen = GetCombinedTrust (first) >= GetCombinedTrust (second) ? &first : &second;
+  }
+  responder = chosen->ip;
+  return true;
+}
+
+
+/* Assign a fixed random variable stream number to the random
+ * variable of GetBalancedNeighbor
+ *
+ * Inputs:
+ * stream: first stream index to use
+ *
+ * Output:
+ * number of stream indices assigned (1)
+ */
+
+int64_t
+Node::AssignStreams (int64_t stream)
+{
+  NS_LOG_FUNCTION (this << stream);
+  if (m_responderRng == 0)
+	  m_responderRng = CreateObject<UniformRandomVariable> ();
+  m_responderRng->SetStream (stream);
+  return 1;
+}
+
+
+/* Invalidate the emergency route cache. Called whenever a
+ * neighbor is registered, refreshed or removed
+ *
+ * Inputs: NIL
+ *
+ * Output: NIL
+ */
+
+void
+Node::NotifyNeighborChange (void)
+{
+  for (uint8_t c = 0; c < StealthHeader::MAX_ROUTED_COMPETENCES; c++)
+    m_routeCache[c].valid = false;
+}
+
+
+/* Get the number of hops from this node to the nearest responder
+ * of a competence, as known from the neighbors' advertisements.
+ * Distances beyond the emergency hop limit are not advertised, which
+ * bounds stale routes looping through the crowd.
+ *
+ * Inputs:
+ * competence: interned competence id of the responder
+ *
+ * Output:
+ * hops: number of hops (0 if this node has the competence),
+ * 		 or StealthHeader::NO_ROUTE
+ */
+
+uint8_t
+Node::GetResponderHops (uint8_t competence)
+{
+  NS_LOG_FUNCTION (this);
+  // before the routed range check: a responder of any competence id
+  // is its own responder
+  if (GetCompetenceId () == competence)
+	  return 0;
+  if (competence >= StealthHeader::MAX_ROUTED_COMPETENCES)
+	  return StealthHeader::NO_ROUTE;
+
+  Route &route = m_routeCache[competence];
+  if (!route.valid)
+  {
+	  double trust = 0.0;
+	  route.hops = StealthHeader::NO_ROUTE;
+	  for (NeighborHandlerList::iterator it = m_neighborList.begin ();
+			  it != m_neighborList.end (); it++)
+	  {
+		  uint8_t advertised = (it->competenceId == competence) ? 0 : it->responderHops[competence];
+		  if (advertised >= m_emergencyHopLimit)
+			  continue;
+		  uint8_t hops = advertised + 1;
+		  // fewer hops first, then the biggest trust
+		  double combined = GetCombinedTrust (*it);
+		  if (hops < route.hops || (hops == route.hops && combined > trust))
+		  {
+			  route.hops = hops;
+			  route.nextHop = it->ip;
+			  trust = combined;
+		  }
+	  }
+	  route.valid = true;
+  }
+  return route.hops;
+}
+
+
+/* Get the neighbor to forward an emergency to, greedily toward the
+ * nearest known responder. Competences should be given in order of
+ * priority, from 0 to n, as in GetPlusTrustNeighbor: the first one
+ * with a responder in reach decides.
+ *
+ * Inputs:
+ * competences: competences used in simulation
+ * hopLimit: number of hops the emergency may still travel
+ * nextHop: receives the IP address of the next hop
+ *
+ * Output:
+ * LOCAL_RESPONDER:	this node is a responder, the emergency is delivered here
+ * NEXT_HOP:		a responder is reachable within hopLimit through nextHop
+ * NO_RESPONDER:	no responder is known within hopLimit
+ */
+
+Node::EmergencyRoute
+Node::GetEmergencyNextHop (std::vector<std::string> competences,
+                           uint8_t hopLimit,
+                           Address &nextHop)
+{
+  NS_LOG_FUNCTION (this);
+  for (uint8_t i = 0; i != competences.size (); i++)
+  {
+	  // a competence no node ever had has no responder
+	  uint8_t competence;
+	  if (!StealthHeader::FindCompetenceId (competences[i], competence))
+		  continue;
+	  uint8_t hops = GetResponderHops (competence);
+	  if (hops == 0)
+		  return LOCAL_RESPONDER;
+	  if (hops > hopLimit)
+		  continue;
+	  nextHop = m_routeCache[competence].nextHop;
+	  return NEXT_HOP;
+  }
+  return NO_RESPONDER;
+}
+
+
+/* Prepare a received emergency to be relayed: spend one hop of its
+ * hop limit and tag it as the original, so that it keeps its
+ * duplicate key and priority. The next hop is then chosen with
+ * GetEmergencyNextHop and the updated hop limit.
+ *
+ * Inputs:
+ * packet: Copy of the received packet, starting with its emergency header
+ * header: Receives the updated emergency header
+ *
+ * Output:
+ * true:	the packet is ready to be relayed
+ * false:	the emergency has no hop left and must not be relayed
+ */
+
+bool
+Node::RelayEmergency (Ptr<Packet> packet, StealthHeader &header)
+{
+  NS_LOG_FUNCTION (this << packet);
+  packet->RemoveHeader (header);
+  NS_ASSERT_MSG (header.GetMessageType () == StealthHeader::EMERGENCY, "Relaying a non-emergency packet");
+  if (header.GetHopLimit () <= 1)
+  {
+	  packet->AddHeader (header);
+	  return false;
+  }
+  header.SetHopLimit (header.GetHopLimit () - 1);
+  packet->AddHeader (header);
+  TagEmergency (packet, header);
+  TagPriority (packet, header);
+  return true;
+}
+
+
+/* Verify if a node is neighbor of this one
+ *
+ * Inputs:
+ * ip: IP address of a node
+ *
+ * Output:
+ * true:	Node searched is neighbor
+ * false:	Node searched is not neighbor
+ */
+
+bool
+Node::IsAlreadyNeighbor(Address ip)
+{
+  NS_LOG_FUNCTION (this);
+  STEALTH_RECORD (IS_ALREADY_NEIGHBOR, ip);
+  return FindNeighborIndex (ip) < m_neighborList.size ();
+}
+
+
+/* Find a neighbor once for all the reads and updates of its entry.
+ * Counts as an IsAlreadyNeighbor call for the call recorder.
+ *
+ * Inputs:
+ * ip: IP address of a node
+ *
+ * Output:
+ * handle: handle on the neighbor entry, empty if the node
+ * 		   is not a neighbor
+ */
+
+Node::NeighborHandle
+Node::FindNeighbor (Address ip)
+{
+  NS_LOG_FUNCTION (this);
+  STEALTH_RECORD (IS_ALREADY_NEIGHBOR, ip);
+  uint32_t i = FindNeighborIndex (ip);
+  return i < m_neighborList.size () ? NeighborHandle (this, i) : NeighborHandle ();
+}
+
+
+/* Find a neighbor by node id, for the neighbors known from their
+ * hellos
+ *
+ * Inputs:
+ * node: id of a node
+ *
+ * Output:
+ * handle: handle on the neighbor entry, empty if the node is not
+ * 		   a neighbor or its id is not known
+ */
+
+Node::NeighborHandle
+Node::FindNeighborNode (uint32_t node)
+{
+  NS_LOG_FUNCTION (this << node);
+  if (node == NO_NODE)
+	  return NeighborHandle ();
+  for (uint32_t i = 0; i < m_neighborList.size (); i++)
+	  if (m_neighborList[i].node == node)
+		  return NeighborHandle (this, i);
+  return NeighborHandle ();
+}
+
+
+/* Get the trust in the neighbors known from their hellos, for the
+ * callers looking up many nodes at once
+ *
+ * Inputs: NIL
+ *
+ * Output:
+ * trusts: trust in each neighbor, as GetNeighborTrust, by node id
+ */
+
+std::map<uint32_t, double>
+Node::GetNeighborNodeTrusts ()
+{
+  NS_LOG_FUNCTION (this);
+  std::map<uint32_t, double> trusts;
+  for (uint32_t i = 0; i < m_neighborList.size (); i++)
+	  if (m_neighborList[i].node != NO_NODE)
+		  trusts[m_neighborList[i].node] = GetCombinedTrust (m_neighborList[i]);
+  return trusts;
+}
+
+
+/* Get the index of a neighbor in the neighbor list
+ *
+ * Inputs:
+ * ip: IP address of a node
+ *
+ * Output:
+ * index: index of the neighbor, or the size of the list if
+ * 		  the node is not a neighbor
+ */
+
+uint32_t
+Node::FindNeighborIndex (const Address &ip) const
+{
+  for (uint32_t i = 0; i < m_neighborList.size (); i++)
+	  if (m_neighborList[i].ip == ip)
+		  return i;
+  return m_neighborList.size ();
+}
+
+
+Node::NeighborHandle::NeighborHandle ()
+  : m_node (0),
+    m_index (0)
+{
+}
+
+Node::NeighborHandle::NeighborHandle (Node *node, uint32_t index)
+  : m_node (node),
+    m_index (index)
+{
+}
+
+bool
+Node::NeighborHandle::IsEmpty (void) const
+{
+  return m_node == 0;
+}
+
+Address
+Node::NeighborHandle::GetIp (void) const
+{
+  NS_ASSERT_MSG (m_node != 0, "Empty neighbor handle");
+  return m_node->m_neighborList[m_index].ip;
+}
+
+bool
+Node::NeighborHandle::IsAlive (void) const
+{
+  NS_ASSERT_MSG (m_node != 0, "Empty neighbor handle");
+  return m_node->m_neighborList[m_index].around;
+}
+
+void
+Node::NeighborHandle::TurnOn (void)
+{
+  NS_ASSERT_MSG (m_node != 0, "Empty neighbor handle");
+  m_node->m_neighborList[m_index].around = true;
+}
+
+double
+Node::NeighborHandle::GetTrust (void) const
+{
+  NS_ASSERT_MSG (m_node != 0, "Empty neighbor handle");
+  return m_node->GetCombinedTrust (m_node->m_neighborList[m_index]);
+}
+
+void
+Node::NeighborHandle::SetTrust (double trust)
+{
+  NS_ASSERT_MSG (m_node != 0, "Empty neighbor handle");
+  m_node->m_neighborList[m_index].trust = trust;
+  // routes are chosen by trust on a tie
+  m_node->NotifyNeighborChange ();
+}
+
+const std::string &
+Node::NeighborHandle::GetCompetence (void) const
+{
+  NS_ASSERT_MSG (m_node != 0, "Empty neighbor handle");
+  return m_node->m_neighborList[m_index].competence;
+}
+
+Ptr<const StealthInterestSet>
+Node::NeighborHandle::GetInterestSet (void) const
+{
+  NS_ASSERT_MSG (m_node != 0, "Empty neighbor handle");
+  return m_node->m_neighborList[m_index].interests;
+}
+
+uint8_t
+Node::NeighborHandle::GetLoad (void) const
+{
+  NS_ASSERT_MSG (m_node != 0, "Empty neighbor handle");
+  return m_node->m_neighborList[m_index].load;
+}
+
+
+/* Verify if a node is still in the vicinity
+ *
+ * Inputs:
+ * ip: IP address of a searched node
+ *
+ * Output:
+ * true:	Node is in the vicinity
+ * false:	Node is not in the vicinity, or not a neighbor
+ */
+
+bool
+Node::IsAliveNeighbor(Address ip)
+{
+  NS_LOG_FUNCTION (this);
+  STEALTH_RECORD (IS_ALIVE_NEIGHBOR, ip);
+  uint32_t i = FindNeighborIndex (ip);
+  return i < m_neighborList.size () && m_neighborList[i].around;
+}
+
+
+/* Get a neighbor node's trust
+ * 30Out18
+ *
+ * Inputs:
+ * ip: IP address of a neighbor node
+ *
+ * Output:
+ * trust: neighbor node's trust, blended with its gossiped
+ * 		  reputation when TrustGossipWeight is not null, 0 if
+ * 		  not a neighbor
+ */
+
+double
+Node::GetNeighborTrust (Address ip)
+{
+  NS_LOG_FUNCTION (this);
+  STEALTH_RECORD (GET_NEIGHBOR_TRUST, ip);
+  uint32_t i = FindNeighborIndex (ip);
+  return i < m_neighborList.size () ? GetCombinedTrust (m_neighborList[i]) : 0.0;
+}
+
+/* Get a neighbor node's competence
+ * 09Nov18
+ *
+ * Inputs:
+ * ip: IP address of a neighbor node
+ *
+ * Output:
+ * competence: neighbor node's competence, empty if not a neighbor
+ */
+
+std::string
+Node::GetNeighborCompetence (Address ip)
+{
+  NS_LOG_FUNCTION (this);
+  STEALTH_RECORD (GET_NEIGHBOR_COMPETENCE, ip);
+  uint32_t i = FindNeighborIndex (ip);
+  return i < m_neighborList.size () ? m_neighborList[i].competence : std::string ();
+}
+
+/* Get a neighbor node's interests
+ * 21Nov19
+ *
+ * Inputs:
+ * ip: IP address of a neighbor node
+ *
+ * Output:
+ * interests: neighbor node's interests, empty if not a neighbor
+ */
+
+std::vector<std::string>
+Node::GetNeighborInterests (Address ip)
+{
+  NS_LOG_FUNCTION (this);
+  Ptr<const StealthInterestSet> interests = GetNeighborInterestSet (ip);
+  return interests != 0 ? interests->GetInterests () : std::vector<std::string> ();
+}
+
+/* Get a neighbor node's interned interest set. Interest sets are
+ * shared by all neighbors with the same interests, so two sets
+ * are equal if and only if their pointers are equal.
+ *
+ * Inputs:
+ * ip: IP address of a neighbor node
+ *
+ * Output:
+ * interests: neighbor node's interest set, 0 if not a neighbor
+ */
+
+Ptr<const StealthInterestSet>
+Node::GetNeighborInterestSet (Address ip)
+{
+  NS_LOG_FUNCTION (this);
+  STEALTH_RECORD (GET_NEIGHBOR_INTERESTS, ip);
+  uint32_t i = FindNeighborIndex (ip);
+  return i < m_neighborList.size () ? m_neighborList[i].interests : Ptr<const StealthInterestSet> ();
+}
+
+/* Verify if two neighbor nodes have the same interests
+ *
+ * Inputs:
+ * ip1: IP address of a neighbor node
+ * ip2: IP address of another neighbor node
+ *
+ * Output:
+ * true:	Same interests
+ * false:	Different interests
+ */
+
+bool
+Node::HaveSameInterests (Address ip1, Address ip2)
+{
+  NS_LOG_FUNCTION (this);
+  Ptr<const StealthInterestSet> interests = GetNeighborInterestSet (ip1);
+  return interests != 0 && interests == GetNeighborInterestSet (ip2);
+}
+
+/* Get the neighbors with an interest, from the inverted interest
+ * index: only the matching neighbors are visited
+ *
+ * Inputs:
+ * interest: an interest name
+ *
+ * Output:
+ * ips: IP addresses of the neighbors with that interest, in no
+ * 		particular order
+ */
+
+std::vector<Address>
+Node::GetNeighborsWithInterest (std::string interest)
+{
+  NS_LOG_FUNCTION (this << interest);
+  return GetNeighborsWithInterests (std::vector<std::string> (1, interest));
+}
+
+/* Get the neighbors with all the interests of a list. The shortest
+ * list of the inverted index among those of the interests is scanned
+ * and its entries checked against the other interests at once. The
+ * whole table is scanned when an interest has no bit (past the first
+ * 64 distinct interests)
+ *
+ * Inputs:
+ * interests: interest names
+ *
+ * Output:
+ * ips: IP addresses of the neighbors with all the interests, in no
+ * 		particular order; all the neighbors if the list is empty
+ */
+
+std::vector<Address>
+Node::GetNeighborsWithInterests (const std::vector<std::string> &interests)
+{
+  NS_LOG_FUNCTION (this << interests.size ());
+  std::vector<Address> ips;
+  if (interests.empty ())
+  {
+	  for (NeighborHandlerList::const_iterator i = m_neighborList.begin ();
+			  i != m_neighborList.end (); i++)
+		  ips.push_back (i->ip);
+	  return ips;
+  }
+
+  uint64_t mask = 0;
+  const InterestKeyList *shortest = 0;
+  std::vector<std::string> extra;
+  for (std::vector<std::string>::const_iterator i = interests.begin ();
+		  i != interests.end (); i++)
+  {
+	  // an interest nobody has is not interned by a query
+	  uint8_t bit;
+	  if (!StealthHeader::FindInterestBit (*i, bit))
+	  {
+		  if (StealthInterestSet::GetNExtraSets () == 0)
+			  return ips;
+		  extra.push_back (*i);
+		  continue;
+	  }
+	  if (bit >= m_interestIndex.size () || m_interestIndex[bit].empty ())
+		  return ips;
+	  mask |= (uint64_t) 1 << bit;
+	  if (shortest == 0 || m_interestIndex[bit].size () < shortest->size ())
+		  shortest = &m_interestIndex[bit];
+  }
+  if (!extra.empty ())
+  {
+	  // the interests without a bit are not indexed
+	  for (NeighborHandlerList::const_iterator i = m_neighborList.begin ();
+			  i != m_neighborList.end (); i++)
+	  {
+		  bool match = (i->interests->GetBitset () & mask) == mask;
+		  for (uint32_t e = 0; match && e < extra.size (); e++)
+			  match = i->interests->HasInterest (extra[e]);
+		  if (match)
+			  ips.push_back (i->ip);
+	  }
+	  return ips;
+  }
+  for (InterestKeyList::const_iterator k = shortest->begin (); k != shortest->end (); k++)
+	  if ((k->interests & mask) == mask)
+		  ips.push_back (k->ip);
+  return ips;
+}
+
+/* Add a neighbor to the lists of its interests in the
+ * inverted interest index
+ *
+ * Inputs:
+ * ip: Neighbor IP address
+ * interests: Neighbor interned interests
+ *
+ * Output: NIL
+ */
+
+void
+Node::IndexInterests (const Address &ip, Ptr<const StealthInterestSet> interests)
+{
+  uint64_t bitset = interests->GetBitset ();
+  InterestKey key;
+  key.ip = ip;
+  key.interests = bitset;
+  for (uint8_t bit = 0; bitset != 0; bit++, bitset >>= 1)
+	  if (bitset & 1)
+	  {
+		  if (bit >= m_interestIndex.size ())
+			  m_interestIndex.resize (bit + 1);
+		  m_interestIndex[bit].push_back (key);
+	  }
+}
+
+/* Remove a neighbor from the lists of its interests in the
+ * inverted interest index
+ *
+ * Inputs:
+ * ip: Neighbor IP address
+ * interests: Neighbor interned interests
+ *
+ * Output: NIL
+ */
+
+void
+Node::UnindexInterests (const Address &ip, Ptr<const StealthInterestSet> interests)
+{
+  uint64_t bitset = interests->GetBitset ();
+  for (uint8_t bit = 0; bitset != 0; bit++, bitset >>= 1)
+	  if (bitset & 1)
+	  {
+		  InterestKeyList &keys = m_interestIndex[bit];
+		  for (uint32_t k = 0; k < keys.size (); k++)
+			  if (keys[k].ip == ip)
+			  {
+				  keys[k] = keys.back ();
+				  keys.pop_back ();
+				  break;
+			  }
+	  }
+}
+
+/* Get the number of node's neighbors
+ * 16Nov18
+ *
+ * Output:
+ * int: number of node's neighbors
+ */
+
+int
+Node::GetNNeighbors (void)
+{
+  NS_LOG_FUNCTION (this);
+  STEALTH_RECORD (GET_N_NEIGHBORS);
+  return (int)m_neighborList.size ();
+}
+
+/* Get node's service status
+ * 090119
+ * Inputs: NIL
+ *
+ * Output:
+ * m_service: Node's service status
+ * 			  Service received: true
+ * 			  Service not received:	false
+ */
+
+bool
+Node::GetServiceStatus (void)
+{
+  NS_LOG_FUNCTION (this);
+  return m_servicestatus;
+}
+
+/* Get node's service priority
+ * 090119
+ * Inputs: NIL
+ *
+ * Output:
+ * m_service: Node's service priority (0,1,2,3)
+ *
+ */
+
+int
+Node::GetServicePriority (void)
+{
+  NS_LOG_FUNCTION (this);
+  return m_servicepriority;
+}
+
+
+/* Set node's service status. Typed alternative to the
+ * "ServiceStatus" attribute
+ *
+ * Inputs:
+ * serviceStatus: Node's service status
+ * 				  Service received: true
+ * 				  Service not received:	false
+ *
+ * Output: NIL
+ */
+
+void
+Node::SetServiceStatus (bool serviceStatus)
+{
+  NS_LOG_FUNCTION (this << serviceStatus);
+  m_servicestatus = serviceStatus;
+}
+
+/* Set node's service priority. Typed alternative to the
+ * "ServicePriority" attribute
+ *
+ * Inputs:
+ * servicePriority: Node's service priority (0,1,2,3)
+ *
+ * Output: NIL
+ */
+
+void
+Node::SetServicePriority (int servicePriority)
+{
+  NS_LOG_FUNCTION (this << servicePriority);
+  NS_ASSERT_MSG (servicePriority >= 0 && servicePriority <= 255,
+                 "Service priority " << servicePriority << " out of range");
+  m_servicepriority = servicePriority;
+}
+
+/* Set node's status, competence, service status and service
+ * priority at once
+ *
+ * Inputs:
+ * profile: Stealth attributes of the node
+ *
+ * Output: NIL
+ */
+
+void
+Node::SetStealthProfile (const StealthProfile &profile)
+{
+  NS_LOG_FUNCTION (this);
+  SetStatus (profile.status);
+  SetCompetence (profile.competence);
+  SetServiceStatus (profile.serviceStatus);
+  SetServicePriority (profile.servicePriority);
+}
+
+/* Set the same Stealth attributes on a range of nodes, e.g.
+ * NodeContainer::Begin ()/End () or NodeList::Begin ()/End ().
+ * Costs O(1) per node, unlike Config::Set on NodeList wildcard paths
+ *
+ * Inputs:
+ * begin: first node of the range
+ * end: past the last node of the range
+ * profile: Stealth attributes of the nodes
+ *
+ * Output: NIL
+ */
+
+void
+Node::SetStealthProfile (std::vector<Ptr<Node> >::const_iterator begin,
+                         std::vector<Ptr<Node> >::const_iterator end,
+                         const StealthProfile &profile)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  for (std::vector<Ptr<Node> >::const_iterator i = begin; i != end; i++)
+    (*i)->SetStealthProfile (profile);
 }
 
-
-/* Check node's neighbors' list for the node with the biggest trust
- * based on competences used in simulation. They should be given in
- * order of priority, from 0 to n.
- * 06Nov18
+/* Register a attending call in node's attending list
+ * 30Jan19
  *
- * Do not check if neighbor list is empty. This must be done
- * before through method Node::IsThereAnyNeighbor
+ * For the service metrics, the caller is the node that sent the
+ * hellos of the neighbor ip. A caller registered with the competence
+ * and interests overload of RegisterNeighbor, or not a neighbor, is
+ * of unknown origin and does not count its emergency as served: use
+ * the StealthHeader overload then
  *
  * Inputs:
- * competences: ompetences used in simulation
+ * ip: Neighbor's node IP address
+ * criticalData: Attending's node critical data
+ * priority: Attending's node priority
+ * attendingCallTime: Attending's node call time
  *
- * Output:
- * ip: IP address of the biggest trust neighbor node
+ * Output: NIL
  */
 
-Address
-Node::GetPlusTrustNeighbor (std::vector<std::string> competences)
+void
+Node::RegisterAttendingCall (Address ip,
+							 std::string criticalData,
+							 int priority,
+							 double attendingCallTime)
 {
-  double trust = 0.0;
-  bool gotTrust = false;
-  NeighborHandlerList::iterator n;
-  NS_LOG_FUNCTION (this);
+	NS_LOG_FUNCTION (this);
+	struct Node::Attending attending;
 
-  // search for the biggest competence
-  for (uint8_t i = 0; i != competences.size(); i++ )
-  {
-	  // search for the biggest trust with that competence
-	  for (NeighborHandlerList::iterator it = m_neighborList.begin ();
-			  it != m_neighborList.end (); it++)
-	  {
-		  if (it->competence == competences[i])
-		  {
-			  if (it->trust > trust)
-			  {
-				  trust = it->trust;
-				  n = it;
-				  gotTrust = true;
-			  }
-		  }
-	  }
-	  if (gotTrust)
-		  break;
-  }
-  return n->ip;
+	attending.ip = ip;
+	attending.criticalData = criticalData;
+	attending.attendingPriority = priority;
+	attending.attendingTime = attendingCallTime;
+	m_attendingList.push_back (attending);
+	if (StealthMetrics::IsEnabled ())
+	{
+		// the caller is identified through the hellos it sent; the
+		// neighbors registered without a header have no known node
+		uint32_t i = FindNeighborIndex (ip);
+		uint32_t origin = i < m_neighborList.size () && m_neighborList[i].node != NO_NODE ?
+				m_neighborList[i].node : StealthMetrics::NO_ORIGIN;
+		StealthMetrics::NotifyAttendingCall (origin, m_attendingList.size ());
+	}
 }
 
 
-/* Verify if a node is neighbor of this one
+/* Register a attending call from a received emergency StealthHeader
  *
  * Inputs:
- * ip: IP address of a node
+ * ip: Neighbor's node IP address
+ * header: Emergency header carrying priority and critical data
+ * attendingCallTime: Attending's node call time
  *
- * Output:
- * true:	Node searched is neighbor
- * false:	Node searched is not neighbor
+ * Output: NIL
  */
 
-bool
-Node::IsAlreadyNeighbor(Address ip)
+void
+Node::RegisterAttendingCall (Address ip,
+							 const StealthHeader &header,
+							 double attendingCallTime)
 {
-  NS_LOG_FUNCTION (this);
-  bool inTheList = false;
+	NS_LOG_FUNCTION (this);
+	struct Node::Attending attending;
 
-  for (NeighborHandlerList::iterator i = m_neighborList.begin ();
-       i != m_neighborList.end (); i++)
-       if (i->ip == ip)
-       {
-    	   inTheList = true;
-    	   break;
-       }
-  return inTheList;
+	attending.ip = ip;
+	attending.criticalData = header.GetCriticalDataString ();
+	attending.attendingPriority = header.GetPriority ();
+	attending.attendingTime = attendingCallTime;
+	m_attendingList.push_back (attending);
+	if (StealthMetrics::IsEnabled ())
+		StealthMetrics::NotifyAttendingCall (header.GetOrigin (), m_attendingList.size ());
 }
 
 
-/* Verify if a node is still in the vicinity
+/* Fill a hello StealthHeader with this node's competence and interests,
+ * and a summary of its own trust: the neighbors it trusts most, with
+ * their local trust (never the gossiped one, so that reports do not
+ * echo through the crowd), divided by the highest one when it is
+ * above 1. Aborts if the node has interests without a bit, which a
+ * hello cannot carry
  *
  * Inputs:
- * ip: IP address of a searched node
+ * header: Header to be filled
  *
- * Output:
- * true:	Node is in the vicinity
- * false:	Node is not in the vicinity
+ * Output: NIL
  */
 
-bool
-Node::IsAliveNeighbor(Address ip)
+void
+Node::FillHelloHeader (StealthHeader &header)
 {
   NS_LOG_FUNCTION (this);
-  NeighborHandlerList::iterator i;
-  for (i = m_neighborList.begin ();
-       i != m_neighborList.end (); i++)
-       if (i->ip == ip)
-    	   break;
-  return i->around;
+  header.SetMessageType (StealthHeader::HELLO);
+  header.SetCompetence (GetCompetenceId ());
+  NS_ABORT_MSG_IF (m_interests->HasExtraInterests (), "Node " << m_id << " has interests past the "
+		  << (uint32_t) StealthHeader::MAX_INTERESTS << " a hello can advertise");
+  header.SetInterests (m_interests->GetBitset ());
+  header.SetPriority (m_servicepriority);
+  header.SetLoad (GetPendingLoad ());
+  header.SetOrigin (m_id);
+  for (uint8_t c = 0; c < StealthHeader::MAX_ROUTED_COMPETENCES; c++)
+    header.SetResponderHops (c, GetResponderHops (c));
+
+  header.ClearTrustReports ();
+  std::vector<std::pair<double, uint32_t> > ranked;
+  for (NeighborHandlerList::const_iterator it = m_neighborList.begin ();
+		  it != m_neighborList.end (); it++)
+	  if (it->node != NO_NODE)
+		  ranked.push_back (std::make_pair (-it->trust, it->node));
+  uint32_t count = ranked.size () < StealthHeader::MAX_TRUST_REPORTS ?
+		  ranked.size () : (uint32_t) StealthHeader::MAX_TRUST_REPORTS;
+  std::partial_sort (ranked.begin (), ranked.begin () + count, ranked.end ());
+  // reports are in [0,1]: local trusts above 1 are scaled by the
+  // highest one, which keeps their order
+  double scale = count > 0 && -ranked[0].first > 1.0 ? -ranked[0].first : 1.0;
+  for (uint32_t r = 0; r < count; r++)
+	  header.AddTrustReport (ranked[r].second, -ranked[r].first / scale);
 }
 
 
-/* Get a neighbor node's trust
- * 30Out18
+/* Store the trust reports of a hello received from a neighbor as
+ * the row of its origin in the trust matrix, replacing the previous
+ * summary of that node. Reports about this node are left out, and
+ * the row is removed when the neighbor leaves the table, so that the
+ * matrix holds at most one row per neighbor.
  *
  * Inputs:
- * ip: IP address of a neighbor node
+ * header: Hello header received from the neighbor
  *
  * Output:
- * trust: neighbor node's trust
+ * true:	the trust matrix changed
+ * false:	the neighbor reported the same as before
  */
 
-double
-Node::GetNeighborTrust (Address ip)
+bool
+Node::ReceiveTrustReports (const StealthHeader &header)
 {
   NS_LOG_FUNCTION (this);
-  NeighborHandlerList::iterator i;
-  for (i = m_neighborList.begin ();
-      i != m_neighborList.end (); i++)
-	  	  if (i->ip == ip)
-	  		  break;
-  return i->trust;
+  std::vector<StealthTrustMatrix::Report> reports;
+  for (uint8_t r = 0; r < header.GetNTrustReports (); r++)
+  {
+	  StealthTrustMatrix::Report report;
+	  report.subject = header.GetTrustReportSubject (r);
+	  report.trust = header.GetTrustReportTrust (r);
+	  if (report.subject != m_id)
+		  reports.push_back (report);
+  }
+  if (reports.empty ())
+	  return m_trustReports.RemoveRow (header.GetOrigin ());
+  return m_trustReports.SetRow (header.GetOrigin (), reports);
 }
 
-/* Get a neighbor node's competence
- * 09Nov18
+
+/* Get the trust in a neighbor used to choose among neighbors: the
+ * local trust, blended with the reputation gossiped by the other
+ * nodes according to the TrustGossipWeight attribute
  *
  * Inputs:
- * ip: IP address of a neighbor node
+ * neighbor: a neighbor entry
  *
  * Output:
- * competence: neighbor node's competence
+ * trust: (1 - weight) * local trust + weight * reputation, or the
+ * 		  local trust if nobody reported about the neighbor
  */
 
-std::string
-Node::GetNeighborCompetence (Address ip)
+double
+Node::GetCombinedTrust (const Neighbor &neighbor) const
 {
-  NS_LOG_FUNCTION (this);
-  NeighborHandlerList::iterator i;
-  for (i = m_neighborList.begin ();
-      i != m_neighborList.end (); i++)
-	  	  if (i->ip == ip)
-	  		  break;
-  return i->competence;
+  double reputation;
+  if (m_trustGossipWeight <= 0.0 || neighbor.node == NO_NODE
+		  || !m_trustReports.GetReputation (neighbor.node, reputation))
+	  return neighbor.trust;
+  return (1.0 - m_trustGossipWeight) * neighbor.trust + m_trustGossipWeight * reputation;
 }
 
-/* Get a neighbor node's interests
- * 21Nov19
+
+/* Fill an emergency StealthHeader with this node's priority and
+ * the critical data suitable to the responder competence
  *
  * Inputs:
- * ip: IP address of a neighbor node
+ * header: Header to be filled
+ * competence: competence of the responder node
  *
- * Output:
- * interests: neighbor node's interests
+ * Output: NIL
  */
 
-std::vector<std::string>
-Node::GetNeighborInterests (Address ip)
+void
+Node::FillEmergencyHeader (StealthHeader &header, std::string competence)
 {
   NS_LOG_FUNCTION (this);
-  NeighborHandlerList::iterator i;
-  for (i = m_neighborList.begin ();
-      i != m_neighborList.end (); i++)
-	  	  if (i->ip == ip)
-	  		  break;
-  return i->interests;
+  header.SetMessageType (StealthHeader::EMERGENCY);
+  header.SetCompetence (GetCompetenceId ());
+  header.SetPriority (m_servicepriority);
+  header.SetCriticalData (GetCriticalInfo (competence));
+  header.SetOrigin (m_id);
+  header.SetSequence (++m_emergencySequence);
+  header.SetHopLimit (m_emergencyHopLimit);
 }
 
-/* Get the number of node's neighbors
- * 16Nov18
+
+/* Tag an emergency packet with its (origin, sequence) pair, so
+ * that copies relayed back to a node are dropped on reception.
+ * Relays must tag the forwarded packet with the received header.
  *
- * Output:
- * int: number of node's neighbors
+ * Inputs:
+ * packet: Packet carrying the emergency header
+ * header: Emergency header of the packet
+ *
+ * Output: NIL
  */
 
-int
-Node::GetNNeighbors (void)
+void
+Node::TagEmergency (Ptr<Packet> packet, const StealthHeader &header)
 {
-  NS_LOG_FUNCTION (this);
-  return (int)m_neighborList.size ();
+  NS_LOG_FUNCTION (this << packet);
+  StealthTag tag (header.GetOrigin (), header.GetSequence ());
+  StealthTag previous;
+  packet->RemovePacketTag (previous);
+  packet->AddPacketTag (tag);
+  m_duplicateCache.CheckAndInsert (tag.GetKey (), Simulator::Now ());
 }
 
-/* Get node's service status
- * 090119
- * Inputs: NIL
+
+/* Map a StealthHeader to a socket priority (0..7). Emergencies are
+ * ranked by their service priority, 1 being the most urgent; hellos
+ * get the background priority.
+ *
+ *   hello                 -> 1 (background)
+ *   emergency priority 1  -> 6
+ *   emergency priority 2  -> 5
+ *   emergency other       -> 4
+ *
+ * The values are those used by the wifi QoS mapping to access
+ * categories (6: voice, 4 and 5: video, 1: background) and are
+ * assigned to bands by GetStealthPriomap.
+ *
+ * Inputs:
+ * header: Header of the packet to be sent
  *
  * Output:
- * m_service: Node's service status
- * 			  Service received: true
- * 			  Service not received:	false
+ * priority: socket priority of the packet
  */
 
-bool
-Node::GetServiceStatus (void)
+uint8_t
+Node::GetSocketPriority (const StealthHeader &header)
 {
-  NS_LOG_FUNCTION (this);
-  return m_servicestatus;
+  if (header.GetMessageType () != StealthHeader::EMERGENCY)
+    return 1;
+  switch (header.GetPriority ())
+    {
+    case 1:
+      return 6;
+    case 2:
+      return 5;
+    default:
+      return 4;
+    }
 }
 
-/* Get node's service priority
- * 090119
- * Inputs: NIL
+
+/* Get the priomap of a PrioQueueDisc serving Stealth traffic
+ * with strict priority over three bands:
  *
- * Output:
- * m_service: Node's service priority (0,1,2,3)
+ *   band 0: emergency priority 1 (socket priority 6, 7)
+ *   band 1: other emergencies (socket priority 4, 5)
+ *   band 2: hellos and any other traffic
+ *
+ * Usage:
+ *   TrafficControlHelper tch;
+ *   tch.SetRootQueueDisc ("ns3::PrioQueueDisc", "Priomap",
+ *                         StringValue (Node::GetStealthPriomap ()));
  *
+ * Output:
+ * priomap: band of each of the 16 socket priorities
  */
 
-int
-Node::GetServicePriority (void)
+std::string
+Node::GetStealthPriomap (void)
 {
-  NS_LOG_FUNCTION (this);
-  return m_servicepriority;
+  return "2 2 2 2 1 1 0 0 2 2 2 2 2 2 2 2";
 }
 
 
-/* Register a attending call in node's attending list
- * 30Jan19
+/* Tag a packet with the socket priority of its StealthHeader, so
+ * that the queue disc and the device queues schedule emergencies
+ * ahead of hellos
  *
  * Inputs:
- * ip: Neighbor's node IP address
- * criticalData: Attending's node critical data
- * priority: Attending's node priority
- * attendingCallTime: Attending's node call time
+ * packet: Packet to be sent
+ * header: Header of the packet
  *
  * Output: NIL
  */
 
 void
-Node::RegisterAttendingCall (Address ip,
-							 std::string criticalData,
-							 int priority,
-							 double attendingCallTime)
+Node::TagPriority (Ptr<Packet> packet, const StealthHeader &header)
 {
-	NS_LOG_FUNCTION (this);
-	struct Node::Attending attending;
-
-	attending.ip = ip;
-	attending.criticalData = criticalData;
-	attending.attendingPriority = priority;
-	attending.attendingTime = attendingCallTime;
-	m_attendingList.push_back (attending);
+  NS_LOG_FUNCTION (this << packet);
+  SocketPriorityTag tag;
+  packet->RemovePacketTag (tag);
+  tag.SetPriority (GetSocketPriority (header));
+  packet->AddPacketTag (tag);
 }
 
 
@@ -949,6 +2745,25 @@ Node::GetNPendingAttending (void)
   return (int)m_attendingList.size ();
 }
 
+/* Get the node's pending attending load advertised in hellos: the
+ * pending attendings weighted by priority (3 for priority 1, 2 for
+ * priority 2, 1 otherwise), saturated at 255
+ *
+ * Output:
+ * load: weighted number of pending attendings
+ */
+
+uint8_t
+Node::GetPendingLoad (void)
+{
+  NS_LOG_FUNCTION (this);
+  uint32_t load = 0;
+  for (AttendingHandlerList::const_iterator i = m_attendingList.begin ();
+       i != m_attendingList.end () && load < 255; i++)
+	  load += i->attendingPriority == 1 ? 3 : i->attendingPriority == 2 ? 2 : 1;
+  return std::min<uint32_t> (load, 255);
+}
+
 /* Remove an attending from nodes' attending list
  * 30Jan19
  * Inputs:
@@ -968,7 +2783,10 @@ Node::CloseAttending (Address ip)
 	  	 {
 		  if (i->ip == ip)
 		  	  {
+			  double callTime = i->attendingTime;
 			  m_attendingList.erase (i);
+			  if (StealthMetrics::IsEnabled ())
+				  StealthMetrics::NotifyAttendingClosed (callTime, m_attendingList.size ());
 			  break;
 		  	  }
 	  	 }
@@ -1004,19 +2822,18 @@ Node::GetAttendingIpList ()
  * ip: IP address of an attending node
  *
  * Output:
- * criticalData: attending node's critical data
+ * criticalData: attending node's critical data, empty if not attended
  */
 
 std::string
 Node::GetAttendingCriticalData (Address ip)
 {
   NS_LOG_FUNCTION (this);
-  AttendingHandlerList::iterator i;
-  for (i = m_attendingList.begin ();
+  for (AttendingHandlerList::iterator i = m_attendingList.begin ();
       i != m_attendingList.end (); i++)
 	  	  if (i->ip == ip)
-	  		  break;
-  return i->criticalData;
+	  		  return i->criticalData;
+  return std::string ();
 }
 
 /* Get an attending node's priority
@@ -1026,19 +2843,171 @@ Node::GetAttendingCriticalData (Address ip)
  * ip: IP address of a neighbor node
  *
  * Output:
- * competence: attending node's priority
+ * priority: attending node's priority, 0 if not attended
  */
 
 int
 Node::GetAttendingPriority (Address ip)
 {
   NS_LOG_FUNCTION (this);
-  AttendingHandlerList::iterator i;
-  for (i = m_attendingList.begin ();
+  for (AttendingHandlerList::iterator i = m_attendingList.begin ();
       i != m_attendingList.end (); i++)
 	  	  if (i->ip == ip)
-	  		  break;
-  return i->attendingPriority;
+	  		  return i->attendingPriority;
+  return 0;
+}
+
+/* Get a digest of the node's Stealth state: status, competence,
+ * service, neighbors (address, trust, presence, competence) and
+ * attendings. Entries are hashed one by one and summed, so the
+ * digest does not depend on the order of the lists.
+ *
+ * Inputs: NIL
+ *
+ * Output:
+ * digest: 64 bits hash of the node's Stealth state
+ */
+
+uint64_t
+Node::GetStealthDigest (void)
+{
+  NS_LOG_FUNCTION (this);
+  uint8_t buffer[Address::MAX_SIZE];
+  uint64_t digest = StealthStateDigest::FNV_OFFSET;
+  uint8_t flags[2] = { m_status, m_servicestatus };
+  digest = StealthStateDigest::Hash (digest, flags, sizeof (flags));
+  digest = StealthStateDigest::Hash (digest, &m_servicepriority, sizeof (m_servicepriority));
+  digest = StealthStateDigest::Hash (digest, m_competence.data (), m_competence.size ());
+
+  uint64_t neighbors = 0;
+  for (NeighborHandlerList::const_iterator i = m_neighborList.begin ();
+       i != m_neighborList.end (); i++)
+    {
+	  uint64_t entry = StealthStateDigest::FNV_OFFSET;
+	  entry = StealthStateDigest::Hash (entry, buffer, i->ip.CopyTo (buffer));
+	  entry = StealthStateDigest::Hash (entry, &i->trust, sizeof (i->trust));
+	  entry = StealthStateDigest::Hash (entry, &i->around, sizeof (i->around));
+	  entry = StealthStateDigest::Hash (entry, &i->competenceId, sizeof (i->competenceId));
+	  neighbors += entry;
+    }
+
+  uint64_t attendings = 0;
+  for (AttendingHandlerList::const_iterator i = m_attendingList.begin ();
+       i != m_attendingList.end (); i++)
+    {
+	  uint64_t entry = StealthStateDigest::FNV_OFFSET;
+	  entry = StealthStateDigest::Hash (entry, buffer, i->ip.CopyTo (buffer));
+	  entry = StealthStateDigest::Hash (entry, i->criticalData.data (), i->criticalData.size ());
+	  entry = StealthStateDigest::Hash (entry, &i->attendingTime, sizeof (i->attendingTime));
+	  entry = StealthStateDigest::Hash (entry, &i->attendingPriority, sizeof (i->attendingPriority));
+	  attendings += entry;
+    }
+
+  digest = StealthStateDigest::Hash (digest, &neighbors, sizeof (neighbors));
+  return StealthStateDigest::Hash (digest, &attendings, sizeof (attendings));
+}
+
+
+Node::StealthMemoryUsage::StealthMemoryUsage ()
+  : neighborEntries (0),
+    neighbors (0),
+    attendings (0),
+    competence (0),
+    duplicateCache (0),
+    trustReports (0)
+{
+}
+
+uint64_t
+Node::StealthMemoryUsage::GetTotal (void) const
+{
+  return neighbors + attendings + competence + duplicateCache + trustReports;
+}
+
+/* Get the bytes used by the node's Stealth containers, including
+ * the heap capacity of their vectors and strings. Interest lists
+ * are shared and reported by StealthInterestSet::GetPoolMemoryUsage
+ *
+ * Inputs: NIL
+ *
+ * Output:
+ * usage: bytes used by each Stealth container
+ */
+
+Node::StealthMemoryUsage
+Node::GetStealthMemoryUsage (void)
+{
+  NS_LOG_FUNCTION (this);
+  StealthMemoryUsage usage;
+
+  usage.neighborEntries = m_neighborList.size ();
+  usage.neighbors = StealthMemoryMonitor::GetHeapSize (m_neighborList);
+  for (NeighborHandlerList::const_iterator i = m_neighborList.begin ();
+       i != m_neighborList.end (); i++)
+	  usage.neighbors += StealthMemoryMonitor::GetHeapSize (i->competence);
+  usage.neighbors += StealthMemoryMonitor::GetHeapSize (m_interestIndex);
+  for (std::vector<InterestKeyList>::const_iterator i = m_interestIndex.begin ();
+       i != m_interestIndex.end (); i++)
+	  usage.neighbors += StealthMemoryMonitor::GetHeapSize (*i);
+
+  usage.attendings = StealthMemoryMonitor::GetHeapSize (m_attendingList);
+  for (AttendingHandlerList::const_iterator i = m_attendingList.begin ();
+       i != m_attendingList.end (); i++)
+	  usage.attendings += StealthMemoryMonitor::GetHeapSize (i->criticalData);
+
+  usage.competence = StealthMemoryMonitor::GetHeapSize (m_competence);
+  usage.duplicateCache = m_duplicateCache.GetMemoryUsage ();
+  usage.trustReports = m_trustReports.GetMemoryUsage ();
+  return usage;
+}
+
+
+/* Free the node's Stealth storage: neighbor and attending lists,
+ * competence, interests, duplicate cache and trust reports. Containers are swapped
+ * with empty ones, since clear () keeps their capacity
+ *
+ * Inputs: NIL
+ *
+ * Output: NIL
+ */
+
+void
+Node::ReleaseStealthState (void)
+{
+  NS_LOG_FUNCTION (this);
+  NeighborHandlerList ().swap (m_neighborList);
+  std::vector<InterestKeyList> ().swap (m_interestIndex);
+  AttendingHandlerList ().swap (m_attendingList);
+  std::string ().swap (m_competence);
+  m_competenceIdCached = false;
+  m_interests = StealthInterestSet::Get (std::vector<std::string> ());
+  m_duplicateCache.Release ();
+  m_trustReports.Clear ();
+  NotifyNeighborChange ();
+}
+
+/* Release the Stealth storage of a range of nodes at once, e.g.
+ * NodeList::Begin () to NodeList::End () between the runs of a
+ * sweep, then give the freed heap back to the system so that the
+ * next run starts from a small heap
+ *
+ * Inputs:
+ * begin: first node of the range
+ * end: past the last node of the range
+ *
+ * Output: NIL
+ */
+
+void
+Node::DisposeStealthState (std::vector<Ptr<Node> >::const_iterator begin,
+                           std::vector<Ptr<Node> >::const_iterator end)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  for (std::vector<Ptr<Node> >::const_iterator i = begin; i != end; i++)
+	  (*i)->ReleaseStealthState ();
+#ifdef __GLIBC__
+  malloc_trim (0);
+#endif
 }
 
 } // namespace ns3
@@ -26,6 +26,7 @@
 #define NODE_H
 
 #include <vector>
+#include <map>
 #include <string> // for string use
 
 #include "ns3/object.h"
@@ -33,6 +34,13 @@
 #include "ns3/ptr.h"
 #include "ns3/net-device.h"
 #include "ns3/string.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/stealth-duplicate-cache.h"
+#include "ns3/stealth-header.h"
+#include "ns3/stealth-interest-set.h"
+#include "ns3/stealth-trust-matrix.h"
 
 
 namespace ns3 {
@@ -189,6 +197,110 @@ public:
    */
   void UnregisterProtocolHandler (ProtocolHandler handler);
 
+  /**
+   * A protocol handler called through a plain function pointer.
+   *
+   * \param context the context given at registration
+   * \param device a borrowed pointer to the receiving device
+   * \param packet a borrowed pointer to the received packet
+   * \param protocol the protocol number of the packet
+   * \param sender the address of the sender
+   * \param receiver the address of the receiver
+   * \param packetType type of packet received
+   *
+   * The device and packet are only guaranteed to live during the
+   * call: a handler keeping one of them must take a Ptr to it.
+   */
+  typedef void (*FastProtocolHandler) (void *context, NetDevice *device, const Packet *packet,
+                                       uint16_t protocol, const Address &sender,
+                                       const Address &receiver, NetDevice::PacketType packetType);
+  /**
+   * \param handler the handler to register
+   * \param context passed back to the handler, not owned by the node
+   * \param protocolType the type of protocol this handler is
+   *        interested in, zero for all protocols
+   * \param device the device attached to this handler, zero for all
+   *        devices on this node
+   * \param promiscuous whether to register a promiscuous mode handler
+   *
+   * Same as RegisterProtocolHandler, but the handler is invoked without
+   * the Callback indirection nor any reference count update, which
+   * matters when every node receives a hello from each of its
+   * neighbors. Handlers of both kinds are invoked in registration order.
+   */
+  void RegisterFastProtocolHandler (FastProtocolHandler handler,
+                                    void *context,
+                                    uint16_t protocolType,
+                                    Ptr<NetDevice> device,
+                                    bool promiscuous=false);
+  /**
+   * \param handler the handler to unregister
+   * \param context the context it was registered with
+   *
+   * After this call returns, the handler will never be invoked
+   * anymore with this context.
+   */
+  void UnregisterFastProtocolHandler (FastProtocolHandler handler, void *context);
+
+  /**
+   * \brief A packet of a burst handed over by a device.
+   */
+  struct ReceivedPacket {
+    Ptr<const Packet> packet;           //!< the received packet
+    uint16_t protocol;                  //!< the protocol number of the packet
+    Address from;                       //!< the address of the sender
+    Address to;                         //!< the address of the receiver
+    NetDevice::PacketType packetType;   //!< type of packet received
+  };
+
+  /**
+   * A protocol handler receiving several packets of one device at once.
+   * The packets are those of a burst matching the protocol of the
+   * handler, in their order of reception. Packets received one by one
+   * through ReceiveFromDevice are queued and given at the end of the
+   * current instant (Simulator::ScheduleNow), as one burst per device
+   * of all the packets received during that instant.
+   */
+  typedef Callback<void,Ptr<NetDevice>,const std::vector<ReceivedPacket> &> BatchProtocolHandler;
+  /**
+   * \param handler the handler to register
+   * \param protocolType the type of protocol this handler is
+   *        interested in, zero for all protocols
+   * \param device the device attached to this handler, zero for all
+   *        devices on this node
+   * \param promiscuous whether to register a promiscuous mode handler
+   */
+  void RegisterBatchProtocolHandler (BatchProtocolHandler handler,
+                                     uint16_t protocolType,
+                                     Ptr<NetDevice> device,
+                                     bool promiscuous=false);
+  /**
+   * \param handler the handler to unregister
+   *
+   * After this call returns, the input handler will never
+   * be invoked anymore.
+   */
+  void UnregisterBatchProtocolHandler (BatchProtocolHandler handler);
+  /**
+   * \param device the receiving device
+   * \param packets packets received by the device in the same time step
+   * \param promiscuous whether the packets were received in promiscuous mode
+   * \returns the number of packets delivered to at least one handler
+   *
+   * Batch counterpart of the device receive callbacks: the context is
+   * checked and the handler list walked once per burst. Batch handlers
+   * are invoked once with their packets; the other handlers are invoked
+   * once per packet, one handler after the other.
+   *
+   * No NetDevice of ns-3 3.28 calls it: they all deliver packets one
+   * by one to ReceiveFromDevice, where the packets for batch handlers
+   * are coalesced per instant instead. A device calling it directly
+   * saves that queueing.
+   */
+  uint32_t ReceiveBurstFromDevice (Ptr<NetDevice> device,
+                                   const std::vector<ReceivedPacket> &packets,
+                                   bool promiscuous);
+
   /**
    * A callback invoked whenever a device is added to a node.
    */
@@ -223,6 +335,124 @@ public:
  * - Insert new node's attributes
 */
 
+   /**
+    * \brief Stealth attributes applied at once by SetStealthProfile.
+    */
+   struct StealthProfile {
+     bool status;							//!< Emergency (true) or Normal (false)
+     std::string competence;				//!< health competence
+     bool serviceStatus;					//!< service received (true)
+     int servicePriority;					//!< service priority (0,1,2,3)
+   };
+
+   /**
+    * \brief A peer seen by a node during a time step.
+    */
+   struct StealthContact {
+     uint32_t node;							//!< id of the node that sees the peer
+     Address ip;							//!< the peer IP address
+     std::string competence;				//!< the peer competence
+     Ptr<const StealthInterestSet> interests; //!< the peer interests
+     double trust;							//!< the peer trust value
+   };
+
+   /**
+    * \brief A hello received by a node, see ReceiveHellos.
+    */
+   struct StealthHello {
+     Address ip;							//!< the sender IP address
+     StealthHeader header;					//!< the hello header
+     double trust;							//!< the sender trust, if new neighbor
+   };
+
+   /**
+    * \brief Where an emergency goes, see GetEmergencyNextHop.
+    */
+   enum EmergencyRoute {
+     NO_RESPONDER,							//!< no responder is known within the hop limit
+     LOCAL_RESPONDER,						//!< this node is a responder, deliver locally
+     NEXT_HOP								//!< forward to the next hop
+   };
+
+   /**
+    * \brief Access to one entry of the neighbor table, see FindNeighbor.
+    *
+    * Reading or updating a field through a handle costs no lookup. A
+    * handle is valid until a neighbor is registered or removed.
+    */
+   class NeighborHandle {
+   public:
+     /**
+      * \brief Create an empty handle.
+      */
+     NeighborHandle ();
+
+     /**
+      * \returns true if the handle refers to no neighbor
+      */
+     bool IsEmpty (void) const;
+     /**
+      * \returns the neighbor IP address
+      */
+     Address GetIp (void) const;
+     /**
+      * \returns true if the neighbor is in the vicinity
+      */
+     bool IsAlive (void) const;
+     /**
+      * \brief Confirm the neighbor presence, as TurnNeighborOn.
+      */
+     void TurnOn (void);
+     /**
+      * \returns the neighbor trust, as GetNeighborTrust
+      */
+     double GetTrust (void) const;
+     /**
+      * \param trust the new local trust in the neighbor
+      */
+     void SetTrust (double trust);
+     /**
+      * \returns the neighbor competence
+      */
+     const std::string &GetCompetence (void) const;
+     /**
+      * \returns the neighbor interned interest set
+      */
+     Ptr<const StealthInterestSet> GetInterestSet (void) const;
+     /**
+      * \returns the pending attending load advertised by the neighbor
+      */
+     uint8_t GetLoad (void) const;
+
+   private:
+     friend class Node;
+     /**
+      * \param node the node owning the table
+      * \param index the entry index in the table
+      */
+     NeighborHandle (Node *node, uint32_t index);
+
+     Node *m_node;       //!< the node owning the table, 0 if empty
+     uint32_t m_index;   //!< the entry index in the table
+   };
+
+  /**
+   * \brief Bytes used by the Stealth state of a node, heap capacity of
+   * vectors and strings included. Interest lists are shared by all
+   * nodes, see StealthInterestSet::GetPoolMemoryUsage.
+   */
+   struct StealthMemoryUsage {
+     uint64_t neighborEntries;				//!< number of neighbor entries
+     uint64_t neighbors;						//!< neighbor list
+     uint64_t attendings;					//!< attending list
+     uint64_t competence;					//!< node competence
+     uint64_t duplicateCache;				//!< emergency duplicate filters
+     uint64_t trustReports;					//!< gossiped trust reports
+
+     StealthMemoryUsage ();
+     uint64_t GetTotal (void) const;
+   };
+
   /*
    * \returns the status of this node.
    *
@@ -230,8 +460,11 @@ public:
    * Normal = false
    */
 
-   bool 		GetStatus (void);
-   std::string 	GetCompetence (void);
+   bool 		GetStatus (void) const;
+   bool			IsActive (void);
+   void			SetActive (bool active);
+   void			SetStatus (bool status);
+   std::string 	GetCompetence (void) const;
    void		 	SetCompetence (std::string competence);
    bool			HasEqualCompetence (std::string competence);
    void			SetInterests (std::vector<std::string> interests);
@@ -239,10 +472,21 @@ public:
 		   	   	   	   	   	   	  std::string competence,
 								  std::vector<std::string> interests,
 								  double trust);
+   void 		RegisterNeighbor (Address ip,
+		   	   	   	   	   	   	  const StealthHeader &header,
+								  double trust);
 
+   void						UpdateNeighbor (Address ip, const StealthHeader &header);
+   void						ReceiveHellos (const std::vector<StealthHello> &hellos);
    void						UnregisterNeighbor (Address ip);
+   void						UpdateNeighborTable (const std::vector<StealthContact> &contacts);
+   static void				UpdateNeighborTables (const std::vector<StealthContact> &contacts,
+		   	   	   	   	   	   	   	   	   	   	  uint32_t nThreads);
    void						UnregisterOffNeighbors ();
    Address					GetPlusTrustNeighbor (std::vector<std::string> competences);
+   bool						GetBalancedNeighbor (std::vector<std::string> competences,
+												 Address &responder);
+   int64_t					AssignStreams (int64_t stream);
    void						TurnNeighborOn (Address ip);
    bool						IsThereAnyNeighbor ();
    std::vector<std::string> GetInterests ();
@@ -250,23 +494,55 @@ public:
    void						TurnOffLiveNeighbors ();
    std::string				GetCriticalInfo(std::string competence);
    bool						IsAlreadyNeighbor (Address ip);
+   NeighborHandle			FindNeighbor (Address ip);
+   NeighborHandle			FindNeighborNode (uint32_t node);
+   std::map<uint32_t, double> GetNeighborNodeTrusts ();
    bool						IsAliveNeighbor(Address ip);
    double					GetNeighborTrust (Address ip);
    std::string				GetNeighborCompetence (Address ip);
    std::vector<std::string> GetNeighborInterests (Address ip);
+   Ptr<const StealthInterestSet> GetNeighborInterestSet (Address ip);
+   bool						HaveSameInterests (Address ip1, Address ip2);
+   std::vector<Address>		GetNeighborsWithInterest (std::string interest);
+   std::vector<Address>		GetNeighborsWithInterests (const std::vector<std::string> &interests);
    int 						GetNNeighbors();
    bool 					GetServiceStatus (void);
+   void						SetServiceStatus (bool serviceStatus);
    int	 					GetServicePriority (void);
+   void						SetServicePriority (int servicePriority);
+   void						SetStealthProfile (const StealthProfile &profile);
+   static void				SetStealthProfile (std::vector<Ptr<Node> >::const_iterator begin,
+		   	   	   	   	   	   	   	   	   	   std::vector<Ptr<Node> >::const_iterator end,
+											   const StealthProfile &profile);
 
    void			RegisterAttendingCall (Address ip,
    							std::string criticalData,
    							int priority,
    							double attendingCallTime);
+   void			RegisterAttendingCall (Address ip,
+   							const StealthHeader &header,
+   							double attendingCallTime);
+   void						FillHelloHeader (StealthHeader &header);
+   void						FillEmergencyHeader (StealthHeader &header, std::string competence);
+   void						TagEmergency (Ptr<Packet> packet, const StealthHeader &header);
+   void						TagPriority (Ptr<Packet> packet, const StealthHeader &header);
+   static uint8_t			GetSocketPriority (const StealthHeader &header);
+   static std::string		GetStealthPriomap (void);
+   uint8_t					GetResponderHops (uint8_t competence);
+   EmergencyRoute			GetEmergencyNextHop (std::vector<std::string> competences,
+		   	   	   	   	   	   	   	   	 uint8_t hopLimit,
+											 Address &nextHop);
+   bool						RelayEmergency (Ptr<Packet> packet, StealthHeader &header);
    std::vector<Address> 	GetAttendingIpList ();
    int 						GetNPendingAttending();
+   uint8_t					GetPendingLoad (void);
    void						CloseAttending (Address ip);
    std::string				GetAttendingCriticalData (Address ip);
    int						GetAttendingPriority (Address ip);
+   uint64_t					GetStealthDigest (void);
+   StealthMemoryUsage		GetStealthMemoryUsage (void);
+   static void				DisposeStealthState (std::vector<Ptr<Node> >::const_iterator begin,
+											 std::vector<Ptr<Node> >::const_iterator end);
 
 protected:
   /**
@@ -319,6 +595,90 @@ private:
   bool ReceiveFromDevice (Ptr<NetDevice> device, Ptr<const Packet>, uint16_t protocol,
                           const Address &from, const Address &to, NetDevice::PacketType packetType, bool promisc);
 
+  /**
+   * \brief Check a received packet against the emergency duplicate cache.
+   * \param packet the packet
+   * \returns true if the packet is a copy of an already received emergency.
+   */
+  bool IsDuplicateEmergency (Ptr<const Packet> packet);
+
+  /**
+   * \brief Invalidate the emergency route cache after a change
+   *        in the neighbor list.
+   */
+  void NotifyNeighborChange (void);
+  /**
+   * \returns the interned id of the node competence, cached until the
+   *          competence changes
+   */
+  uint8_t GetCompetenceId (void);
+  /**
+   * \brief Free the neighbor, attending and interest storage of the node
+   * and its duplicate cache.
+   */
+  void ReleaseStealthState (void);
+  /**
+   * \param ip a neighbor IP address
+   * \returns the index of the neighbor in m_neighborList, or the
+   *          size of the list if ip is not a neighbor
+   */
+  uint32_t FindNeighborIndex (const Address &ip) const;
+  /**
+   * \param ip a neighbor IP address
+   * \param interests the interned interests of the neighbor
+   *
+   * Add the neighbor to the inverted interest index.
+   */
+  void IndexInterests (const Address &ip, Ptr<const StealthInterestSet> interests);
+  /**
+   * \param ip a neighbor IP address
+   * \param interests the interned interests of the neighbor
+   *
+   * Remove the neighbor from the inverted interest index.
+   */
+  void UnindexInterests (const Address &ip, Ptr<const StealthInterestSet> interests);
+  /**
+   * \param header a hello received from a neighbor
+   *
+   * \returns true if the trust matrix changed
+   *
+   * Store the trust reports of the hello in the trust matrix.
+   */
+  bool ReceiveTrustReports (const StealthHeader &header);
+
+  /**
+   * \brief First pass of a neighbor table update: refresh presence and
+   *        trust of known peers and collect the new ones.
+   *
+   * Only touches this node's entries, without logging, so that the
+   * nodes of a simulation can run it concurrently.
+   *
+   * \param contacts all the contacts of the time step
+   * \param indices indices in contacts of this node's contacts, in order
+   * \param count number of indices
+   * \param pending receives the indices of contacts with new peers
+   */
+  void RefreshNeighbors (const std::vector<StealthContact> &contacts,
+                         const uint32_t *indices, uint32_t count,
+                         std::vector<uint32_t> &pending);
+  /**
+   * \brief Second pass of a neighbor table update: prune absent peers
+   *        and register the new ones.
+   * \param contacts all the contacts of the time step
+   * \param pending indices in contacts of the new peers
+   */
+  void ApplyNeighborChanges (const std::vector<StealthContact> &contacts,
+                             const std::vector<uint32_t> &pending);
+
+  struct NeighborTableWork;
+  /**
+   * \brief Thread body of UpdateNeighborTables: refresh the nodes of
+   *        the worker's own range, then steal from the other ranges.
+   * \param work the work shared by all threads
+   * \param worker the index of this worker
+   */
+  static void RunNeighborWorker (NeighborTableWork *work, uint32_t worker);
+
   /**
    * \brief Finish node's construction by setting the correct node ID.
    */
@@ -330,11 +690,38 @@ private:
    */
   struct ProtocolHandlerEntry {
     ProtocolHandler handler; //!< the protocol handler
+    FastProtocolHandler fastHandler; //!< the fast protocol handler, used instead if not zero
+    BatchProtocolHandler batchHandler; //!< the batch protocol handler, used instead if not null
+    void *context;           //!< the fast protocol handler context
     Ptr<NetDevice> device;   //!< the NetDevice
     uint16_t protocol;       //!< the protocol number
     bool promiscuous;        //!< true if it is a promiscuous handler
   };
 
+  /**
+   * \param entry the handler to add
+   *
+   * Add a protocol handler, enabling the promiscuous mode of the
+   * devices it needs.
+   */
+  void AddProtocolHandler (const ProtocolHandlerEntry &entry);
+
+  /**
+   * \brief A packet received through ReceiveFromDevice, waiting for
+   *        the batch handlers.
+   */
+  struct PendingReception {
+    Ptr<NetDevice> device;   //!< the receiving device
+    ReceivedPacket packet;   //!< the packet
+    bool promiscuous;        //!< true if received in promiscuous mode
+  };
+
+  /**
+   * \brief Deliver the packets queued during the current instant to
+   *        the batch handlers, one burst per device and mode.
+   */
+  void FlushReceptions (void);
+
   /// Typedef for protocol handlers container
   typedef std::vector<struct Node::ProtocolHandlerEntry> ProtocolHandlerList;
   /// Typedef for NetDevice addition listeners container
@@ -345,6 +732,9 @@ private:
   std::vector<Ptr<NetDevice> > m_devices; //!< Devices associated to this node
   std::vector<Ptr<Application> > m_applications; //!< Applications associated to this node
   ProtocolHandlerList m_handlers; //!< Protocol handlers in the node
+  std::vector<PendingReception> m_pendingReceptions; //!< Packets waiting for the batch handlers
+  std::vector<ReceivedPacket> m_burst; //!< Reused burst given to batch handlers
+  EventId m_flushEvent;           //!< Pending FlushReceptions
   DeviceAdditionListenerList m_deviceAdditionListeners; //!< Device addition listeners in the node
 
 
@@ -363,15 +753,49 @@ private:
   struct Neighbor {
     Address ip; 							//!< the neighbor IP address
     std::string competence;   				//!< the neighbor competence
-    std::vector <std::string> interests;    //!< the list of neighbor interests
+    Ptr<const StealthInterestSet> interests; //!< the interned list of neighbor interests
     double trust;        					//!< the neighbor trust value
     bool around;							//!< the neighbor presence
+    uint8_t competenceId;					//!< the neighbor interned competence
+    uint8_t responderHops[StealthHeader::MAX_ROUTED_COMPETENCES]; //!< advertised hops to responders
+    uint8_t load;							//!< advertised pending attending load
+    uint32_t node;							//!< the neighbor node id, NO_NODE if unknown
   };
 
+  static const uint32_t NO_NODE = 0xffffffff; //!< Neighbor node id not known
+
+  /**
+   * \param neighbor a neighbor entry
+   * \returns the local trust in the neighbor, blended with its gossiped
+   *          reputation according to m_trustGossipWeight
+   */
+  double GetCombinedTrust (const Neighbor &neighbor) const;
+  /**
+   * \param neighbor the neighbor entry of the sender
+   * \param header a hello received from the neighbor
+   *
+   * \returns true if a value used by the emergency routes changed
+   *
+   * Confirm the presence of the neighbor and store what it advertises.
+   */
+  bool RefreshNeighbor (Neighbor &neighbor, const StealthHeader &header);
+
   // Typedef for neighbors handlers container
   typedef std::vector<struct Node::Neighbor> NeighborHandlerList;
   NeighborHandlerList 		m_neighborList; //!< Neighbor list in the node
 
+  /**
+   * \brief Entry of the inverted interest index.
+   */
+  struct InterestKey {
+    Address ip;								//!< the neighbor IP address
+    uint64_t interests;						//!< the neighbor interest bitset
+  };
+
+  // Typedef for the neighbors of one interest, in no particular order
+  typedef std::vector<struct Node::InterestKey> InterestKeyList;
+  std::vector<InterestKeyList>	m_interestIndex; //!< Neighbors of each interest bit
+
   struct Attending {
     Address ip; 							//!< the attending IP address
     std::string criticalData;	   			//!< the attending data
@@ -383,11 +807,39 @@ private:
   typedef std::vector<struct Node::Attending> AttendingHandlerList;
   AttendingHandlerList 		m_attendingList; //!< Attending list in the node
 
+  /**
+   * \brief Emergency route entry.
+   * Next hop toward the nearest responder of one competence,
+   * computed from the neighbor list on demand.
+   */
+  struct Route {
+    bool valid;								//!< the entry reflects the neighbor list
+    uint8_t hops;							//!< hops to the responder (NO_ROUTE if none)
+    Address nextHop;						//!< the neighbor to forward to
+  };
+
+  Route						m_routeCache[StealthHeader::MAX_ROUTED_COMPETENCES]; //!< Emergency routes per competence
+  uint8_t					m_emergencyHopLimit;	//!< Hop limit of originated emergencies
+  Ptr<UniformRandomVariable>	m_responderRng;		//!< Responder choices of GetBalancedNeighbor, created on first use
+  StealthTrustMatrix		m_trustReports;			//!< Trust reports gossiped by other nodes
+  double					m_trustGossipWeight;	//!< Weight of the reputation in neighbor trust
+
   bool						m_status;		//!< Node status (Emergency = true)
   std::string 				m_competence;	//!< Node competence
-  std::vector<std::string> 	m_interests; 	//!< Node interests
+  uint8_t					m_competenceId;	//!< Interned id of the node competence, when cached
+  bool						m_competenceIdCached;	//!< m_competenceId matches m_competence
+  Ptr<const StealthInterestSet> m_interests; //!< Node interests
   bool						m_servicestatus;		//!< Node receive service (receive = true)
   int						m_servicepriority;		//!< Service priority
+
+  StealthDuplicateCache		m_duplicateCache;		//!< Emergency (origin, sequence) already seen
+  Time						m_duplicateWindow;		//!< Duplicate cache rotation period
+  uint32_t					m_duplicateCacheBits;	//!< Duplicate cache filter size
+  uint32_t					m_emergencySequence;	//!< Last emergency sequence number sent
+  uint64_t					m_lastCheckedUid;		//!< Uid of the last packet checked for duplicates
+  Time						m_lastCheckedTime;		//!< Reception time of the last packet checked for duplicates
+  bool						m_lastCheckedDuplicate;	//!< Result of the last duplicate check
+  bool						m_active;				//!< Node present in the scenario
 };
 
 } // namespace ns3
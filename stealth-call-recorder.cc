@@ -0,0 +1,373 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * STEALTH Project (2019)
+ */
+
+#include <cstring>
+
+#include "stealth-call-recorder.h"
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/simulator.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("StealthCallRecorder");
+
+namespace {
+
+const char MAGIC[8] = { 'S', 'T', 'L', 'C', 'A', 'L', 'L', '1' };  //!< file magic
+const uint32_t BUFFERED_RECORDS = 65536;                           //!< records per write
+
+} // anonymous namespace
+
+std::FILE *StealthCallRecorder::m_file = 0;
+std::vector<struct StealthCallRecorder::Call> StealthCallRecorder::m_buffer;
+std::map<Address, uint32_t> StealthCallRecorder::m_keys;
+
+void
+StealthCallRecorder::Start (std::string fileName)
+{
+  NS_LOG_FUNCTION (fileName);
+  Stop ();
+  m_file = std::fopen (fileName.c_str (), "wb");
+  NS_ABORT_MSG_IF (m_file == 0, "Cannot create call recording " << fileName);
+  NS_ABORT_MSG_IF (std::fwrite (MAGIC, sizeof (MAGIC), 1, m_file) != 1,
+                   "Cannot write call recording " << fileName);
+  m_buffer.reserve (BUFFERED_RECORDS);
+  m_keys.clear ();
+}
+
+void
+StealthCallRecorder::Stop (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  if (m_file == 0)
+    {
+      return;
+    }
+  Flush ();
+  std::fclose (m_file);
+  m_file = 0;
+  m_keys.clear ();
+}
+
+void
+StealthCallRecorder::Record (Op op, uint32_t node, uint32_t aux)
+{
+  struct Call record;
+  std::memset (&record, 0, sizeof (record));
+  record.time = Simulator::Now ().GetSeconds ();
+  record.node = node;
+  record.key = NO_KEY;
+  record.aux = aux;
+  record.op = op;
+  Append (record);
+}
+
+void
+StealthCallRecorder::Record (Op op, uint32_t node, const Address &ip,
+                             uint32_t aux, double value)
+{
+  std::map<Address, uint32_t>::iterator i = m_keys.find (ip);
+  if (i == m_keys.end ())
+    {
+      i = m_keys.insert (std::make_pair (ip, (uint32_t) m_keys.size ())).first;
+    }
+  struct Call record;
+  std::memset (&record, 0, sizeof (record));
+  record.time = Simulator::Now ().GetSeconds ();
+  record.node = node;
+  record.key = i->second;
+  record.aux = aux;
+  record.op = op;
+  record.value = value;
+  Append (record);
+}
+
+uint32_t
+StealthCallRecorder::PackCompetences (const std::vector<uint8_t> &competences)
+{
+  uint32_t packed = 0xffffffff;
+  for (uint32_t i = 0; i < competences.size () && i < 4; i++)
+    {
+      packed &= ~(0xffu << (8 * i));
+      packed |= (uint32_t) competences[i] << (8 * i);
+    }
+  return packed;
+}
+
+void
+StealthCallRecorder::Append (const struct Call &record)
+{
+  m_buffer.push_back (record);
+  if (m_buffer.size () >= BUFFERED_RECORDS)
+    {
+      Flush ();
+    }
+}
+
+void
+StealthCallRecorder::Flush (void)
+{
+  if (!m_buffer.empty ())
+    {
+      NS_ABORT_MSG_IF (std::fwrite (&m_buffer[0], sizeof (struct Call), m_buffer.size (), m_file)
+                       != m_buffer.size (), "Cannot write call recording");
+      m_buffer.clear ();
+    }
+}
+
+void
+StealthCallRecorder::Load (std::string fileName, std::vector<struct Call> &records)
+{
+  NS_LOG_FUNCTION (fileName);
+  std::FILE *file = std::fopen (fileName.c_str (), "rb");
+  NS_ABORT_MSG_IF (file == 0, "Cannot open call recording " << fileName);
+  char magic[sizeof (MAGIC)];
+  NS_ABORT_MSG_IF (std::fread (magic, sizeof (magic), 1, file) != 1
+                   || std::memcmp (magic, MAGIC, sizeof (MAGIC)) != 0,
+                   "Not a call recording: " << fileName);
+  records.clear ();
+  struct Call record;
+  while (std::fread (&record, sizeof (record), 1, file) == 1)
+    {
+      records.push_back (record);
+    }
+  std::fclose (file);
+  NS_LOG_INFO ("Loaded " << records.size () << " calls from " << fileName);
+}
+
+uint64_t
+StealthCallRecorder::Replay (const std::vector<struct Call> &records,
+                             StealthNeighborTableModel &table)
+{
+  NS_LOG_FUNCTION (records.size ());
+  uint64_t checksum = 0;
+  std::vector<uint32_t> keys;
+  for (std::vector<struct Call>::const_iterator r = records.begin (); r != records.end (); r++)
+    {
+      uint64_t result = 0;
+      switch (r->op)
+        {
+        case REGISTER_NEIGHBOR:
+          table.RegisterNeighbor (r->node, r->key, (uint8_t) r->aux, r->value);
+          break;
+        case UPDATE_NEIGHBOR:
+        case TURN_NEIGHBOR_ON:
+          table.TurnNeighborOn (r->node, r->key);
+          break;
+        case UNREGISTER_NEIGHBOR:
+          table.UnregisterNeighbor (r->node, r->key);
+          break;
+        case UNREGISTER_OFF_NEIGHBORS:
+          table.UnregisterOffNeighbors (r->node);
+          break;
+        case TURN_OFF_LIVE_NEIGHBORS:
+          table.TurnOffLiveNeighbors (r->node);
+          break;
+        case IS_ALREADY_NEIGHBOR:
+        case GET_NEIGHBOR_INTERESTS:
+          result = table.IsAlreadyNeighbor (r->node, r->key);
+          break;
+        case IS_ALIVE_NEIGHBOR:
+          result = table.IsAliveNeighbor (r->node, r->key);
+          break;
+        case GET_NEIGHBOR_TRUST:
+          result = (uint64_t) (table.GetNeighborTrust (r->node, r->key) * 1e6);
+          break;
+        case GET_NEIGHBOR_COMPETENCE:
+          result = table.GetNeighborCompetence (r->node, r->key);
+          break;
+        case GET_PLUS_TRUST_NEIGHBOR:
+          result = table.GetPlusTrustNeighbor (r->node, r->aux);
+          break;
+        case GET_N_NEIGHBORS:
+        case IS_THERE_ANY_NEIGHBOR:
+          result = table.GetNNeighbors (r->node);
+          break;
+        case GET_NEIGHBOR_IP_LIST:
+          table.GetNeighborKeys (r->node, keys);
+          result = keys.size ();
+          break;
+        default:
+          NS_ABORT_MSG ("Unknown recorded call " << (uint32_t) r->op);
+        }
+      checksum = (checksum ^ result) * 0x100000001b3ULL;
+    }
+  return checksum;
+}
+
+StealthNeighborTableModel::~StealthNeighborTableModel ()
+{
+}
+
+std::vector<StealthVectorNeighborTable::Entry> &
+StealthVectorNeighborTable::GetList (uint32_t node)
+{
+  if (node >= m_lists.size ())
+    {
+      m_lists.resize (node + 1);
+    }
+  return m_lists[node];
+}
+
+StealthVectorNeighborTable::Entry *
+StealthVectorNeighborTable::Find (uint32_t node, uint32_t key)
+{
+  std::vector<Entry> &list = GetList (node);
+  for (std::vector<Entry>::iterator i = list.begin (); i != list.end (); i++)
+    {
+      if (i->key == key)
+        {
+          return &*i;
+        }
+    }
+  return 0;
+}
+
+void
+StealthVectorNeighborTable::RegisterNeighbor (uint32_t node, uint32_t key, uint8_t competence, double trust)
+{
+  Entry entry;
+  entry.key = key;
+  entry.competence = competence;
+  entry.around = true;
+  entry.trust = trust;
+  GetList (node).push_back (entry);
+}
+
+void
+StealthVectorNeighborTable::UnregisterNeighbor (uint32_t node, uint32_t key)
+{
+  std::vector<Entry> &list = GetList (node);
+  for (std::vector<Entry>::iterator i = list.begin (); i != list.end (); i++)
+    {
+      if (i->key == key)
+        {
+          list.erase (i);
+          break;
+        }
+    }
+}
+
+void
+StealthVectorNeighborTable::UnregisterOffNeighbors (uint32_t node)
+{
+  std::vector<Entry> &list = GetList (node);
+  for (std::vector<Entry>::iterator i = list.begin (); i != list.end (); )
+    {
+      if (!i->around)
+        {
+          i = list.erase (i);
+        }
+      else
+        {
+          ++i;
+        }
+    }
+}
+
+void
+StealthVectorNeighborTable::TurnNeighborOn (uint32_t node, uint32_t key)
+{
+  Entry *entry = Find (node, key);
+  if (entry != 0)
+    {
+      entry->around = true;
+    }
+}
+
+void
+StealthVectorNeighborTable::TurnOffLiveNeighbors (uint32_t node)
+{
+  std::vector<Entry> &list = GetList (node);
+  for (std::vector<Entry>::iterator i = list.begin (); i != list.end (); i++)
+    {
+      i->around = false;
+    }
+}
+
+bool
+StealthVectorNeighborTable::IsAlreadyNeighbor (uint32_t node, uint32_t key)
+{
+  return Find (node, key) != 0;
+}
+
+bool
+StealthVectorNeighborTable::IsAliveNeighbor (uint32_t node, uint32_t key)
+{
+  Entry *entry = Find (node, key);
+  return entry != 0 && entry->around;
+}
+
+double
+StealthVectorNeighborTable::GetNeighborTrust (uint32_t node, uint32_t key)
+{
+  Entry *entry = Find (node, key);
+  return entry != 0 ? entry->trust : 0.0;
+}
+
+uint8_t
+StealthVectorNeighborTable::GetNeighborCompetence (uint32_t node, uint32_t key)
+{
+  Entry *entry = Find (node, key);
+  return entry != 0 ? entry->competence : 0xff;
+}
+
+uint32_t
+StealthVectorNeighborTable::GetPlusTrustNeighbor (uint32_t node, uint32_t competences)
+{
+  std::vector<Entry> &list = GetList (node);
+  for (uint32_t c = 0; c < 4 && ((competences >> (8 * c)) & 0xff) != 0xff; c++)
+    {
+      uint8_t competence = (competences >> (8 * c)) & 0xff;
+      double trust = 0.0;
+      uint32_t key = StealthCallRecorder::NO_KEY;
+      for (std::vector<Entry>::const_iterator i = list.begin (); i != list.end (); i++)
+        {
+          if (i->competence == competence && i->trust > trust)
+            {
+              trust = i->trust;
+              key = i->key;
+            }
+        }
+      if (key != StealthCallRecorder::NO_KEY)
+        {
+          return key;
+        }
+    }
+  return StealthCallRecorder::NO_KEY;
+}
+
+uint32_t
+StealthVectorNeighborTable::GetNNeighbors (uint32_t node)
+{
+  return GetList (node).size ();
+}
+
+void
+StealthVectorNeighborTable::GetNeighborKeys (uint32_t node, std::vector<uint32_t> &keys)
+{
+  std::vector<Entry> &list = GetList (node);
+  keys.clear ();
+  for (std::vector<Entry>::const_iterator i = list.begin (); i != list.end (); i++)
+    {
+      keys.push_back (i->key);
+    }
+}
+
+} // namespace ns3
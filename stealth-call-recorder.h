@@ -0,0 +1,238 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * STEALTH Project (2019)
+ */
+
+#ifndef STEALTH_CALL_RECORDER_H
+#define STEALTH_CALL_RECORDER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdio>
+
+#include "ns3/address.h"
+
+namespace ns3 {
+
+class StealthNeighborTableModel;
+
+/**
+ * \ingroup network
+ *
+ * \brief Recorder of the neighbor table calls made on Node, and replay
+ * of the recorded stream.
+ *
+ * While recording, every Stealth neighbor table call of every node is
+ * appended to a binary file as a fixed-size record: the call, the node
+ * id, the neighbor, an argument and the simulation time. Neighbor
+ * addresses are numbered in order of first appearance, so the stream
+ * can be replayed without the network stack against any
+ * StealthNeighborTableModel, giving repeatable benchmarks with the real
+ * access pattern of a scenario.
+ *
+ * The bulk Node::UpdateNeighborTable and Node::UpdateNeighborTables
+ * paths are not recorded: they go through no recorded call, so a replay
+ * sees none of their lookups, registrations or removals.
+ */
+class StealthCallRecorder
+{
+public:
+  /// Recorded calls
+  enum Op
+  {
+    REGISTER_NEIGHBOR = 1,       //!< aux: competence id, value: trust
+    UPDATE_NEIGHBOR,
+    UNREGISTER_NEIGHBOR,
+    UNREGISTER_OFF_NEIGHBORS,
+    TURN_NEIGHBOR_ON,
+    TURN_OFF_LIVE_NEIGHBORS,
+    IS_ALREADY_NEIGHBOR,
+    IS_ALIVE_NEIGHBOR,
+    GET_NEIGHBOR_TRUST,
+    GET_NEIGHBOR_COMPETENCE,
+    GET_NEIGHBOR_INTERESTS,
+    GET_PLUS_TRUST_NEIGHBOR,     //!< aux: up to 4 competence ids, see PackCompetences
+    GET_N_NEIGHBORS,
+    IS_THERE_ANY_NEIGHBOR,
+    GET_NEIGHBOR_IP_LIST
+  };
+
+  /// A recorded call, as stored in the file
+  struct Call
+  {
+    double time;      //!< simulation time, in seconds
+    uint32_t node;    //!< id of the called node
+    uint32_t key;     //!< neighbor number, NO_KEY if none
+    uint32_t aux;     //!< call argument
+    uint8_t op;       //!< the call, see Op
+    uint8_t reserved[3]; //!< padding
+    double value;     //!< call argument
+  };
+
+  static const uint32_t NO_KEY = 0xffffffff; //!< key of calls without neighbor
+
+  /**
+   * \param fileName the file to record to
+   *
+   * Start recording, truncating the file.
+   */
+  static void Start (std::string fileName);
+  /**
+   * \brief Flush and close the recording file.
+   */
+  static void Stop (void);
+  /**
+   * \returns true while recording
+   */
+  static bool IsEnabled (void)
+  {
+    return m_file != 0;
+  }
+  /**
+   * \param op the call
+   * \param node the called node id
+   * \param aux a call argument
+   */
+  static void Record (Op op, uint32_t node, uint32_t aux = 0);
+  /**
+   * \param op the call
+   * \param node the called node id
+   * \param ip the neighbor address
+   * \param aux a call argument
+   * \param value a call argument
+   */
+  static void Record (Op op, uint32_t node, const Address &ip,
+                      uint32_t aux = 0, double value = 0.0);
+  /**
+   * \param competences competence ids, in order of priority
+   * \returns the first 4 ids packed in a 32 bits argument, unused
+   *          bytes set to 0xff
+   */
+  static uint32_t PackCompetences (const std::vector<uint8_t> &competences);
+
+  /**
+   * \param fileName a recording file
+   * \param records receives the recorded calls
+   */
+  static void Load (std::string fileName, std::vector<struct Call> &records);
+  /**
+   * \param records recorded calls
+   * \param table the neighbor table to run them against
+   * \returns a checksum of the call results, identical for tables
+   *          behaving the same way
+   */
+  static uint64_t Replay (const std::vector<struct Call> &records,
+                          StealthNeighborTableModel &table);
+
+private:
+  /**
+   * \param record a call to append to the file
+   */
+  static void Append (const struct Call &record);
+  /**
+   * \brief Write the buffered records.
+   */
+  static void Flush (void);
+
+  static std::FILE *m_file;                    //!< recording file, 0 if not recording
+  static std::vector<struct Call> m_buffer;  //!< records not yet written
+  static std::map<Address, uint32_t> m_keys;   //!< neighbor number of each address
+};
+
+/**
+ * \ingroup network
+ *
+ * \brief Neighbor table interface for StealthCallRecorder::Replay.
+ *
+ * Methods mirror the Node neighbor table calls, with neighbors given by
+ * their recorded number. Lookups of unknown neighbors must be tolerated.
+ */
+class StealthNeighborTableModel
+{
+public:
+  virtual ~StealthNeighborTableModel ();
+
+  virtual void RegisterNeighbor (uint32_t node, uint32_t key, uint8_t competence, double trust) = 0;
+  virtual void UnregisterNeighbor (uint32_t node, uint32_t key) = 0;
+  virtual void UnregisterOffNeighbors (uint32_t node) = 0;
+  virtual void TurnNeighborOn (uint32_t node, uint32_t key) = 0;
+  virtual void TurnOffLiveNeighbors (uint32_t node) = 0;
+  virtual bool IsAlreadyNeighbor (uint32_t node, uint32_t key) = 0;
+  virtual bool IsAliveNeighbor (uint32_t node, uint32_t key) = 0;
+  virtual double GetNeighborTrust (uint32_t node, uint32_t key) = 0;
+  virtual uint8_t GetNeighborCompetence (uint32_t node, uint32_t key) = 0;
+  /**
+   * \param node a node id
+   * \param competences competence ids packed by StealthCallRecorder::PackCompetences
+   * \returns the key of the most trusted neighbor of the first competence
+   *          found, StealthCallRecorder::NO_KEY if none
+   */
+  virtual uint32_t GetPlusTrustNeighbor (uint32_t node, uint32_t competences) = 0;
+  virtual uint32_t GetNNeighbors (uint32_t node) = 0;
+  virtual void GetNeighborKeys (uint32_t node, std::vector<uint32_t> &keys) = 0;
+};
+
+/**
+ * \ingroup network
+ *
+ * \brief Reference model with the layout of Node: one unsorted vector of
+ * neighbors per node, searched linearly.
+ */
+class StealthVectorNeighborTable : public StealthNeighborTableModel
+{
+public:
+  virtual void RegisterNeighbor (uint32_t node, uint32_t key, uint8_t competence, double trust);
+  virtual void UnregisterNeighbor (uint32_t node, uint32_t key);
+  virtual void UnregisterOffNeighbors (uint32_t node);
+  virtual void TurnNeighborOn (uint32_t node, uint32_t key);
+  virtual void TurnOffLiveNeighbors (uint32_t node);
+  virtual bool IsAlreadyNeighbor (uint32_t node, uint32_t key);
+  virtual bool IsAliveNeighbor (uint32_t node, uint32_t key);
+  virtual double GetNeighborTrust (uint32_t node, uint32_t key);
+  virtual uint8_t GetNeighborCompetence (uint32_t node, uint32_t key);
+  virtual uint32_t GetPlusTrustNeighbor (uint32_t node, uint32_t competences);
+  virtual uint32_t GetNNeighbors (uint32_t node);
+  virtual void GetNeighborKeys (uint32_t node, std::vector<uint32_t> &keys);
+
+private:
+  /// Neighbor entry
+  struct Entry
+  {
+    uint32_t key;        //!< neighbor number
+    uint8_t competence;  //!< competence id
+    bool around;         //!< neighbor in the vicinity
+    double trust;        //!< neighbor trust
+  };
+
+  /**
+   * \param node a node id
+   * \returns the neighbor list of the node, created if needed
+   */
+  std::vector<Entry> &GetList (uint32_t node);
+  /**
+   * \param node a node id
+   * \param key a neighbor number
+   * \returns the entry of the neighbor, 0 if unknown
+   */
+  Entry *Find (uint32_t node, uint32_t key);
+
+  std::vector<std::vector<Entry> > m_lists;  //!< neighbor list of each node
+};
+
+} // namespace ns3
+
+#endif /* STEALTH_CALL_RECORDER_H */
@@ -0,0 +1,201 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * STEALTH Project (2019)
+ */
+
+#include <cmath>
+#include <algorithm>
+
+#include "stealth-contact-tracker.h"
+#include "ns3/log.h"
+#include "ns3/assert.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("StealthContactTracker");
+
+StealthContactTracker::StealthContactTracker (double range, double moveThreshold)
+  : m_range (range),
+    m_moveThreshold (moveThreshold),
+    m_nEvaluated (0)
+{
+  NS_LOG_FUNCTION (this << range << moveThreshold);
+  NS_ASSERT_MSG (range > 0, "Contact range must be positive");
+}
+
+uint64_t
+StealthContactTracker::GetCell (const Vector &position) const
+{
+  int32_t cx = static_cast<int32_t> (std::floor (position.x / m_range));
+  int32_t cy = static_cast<int32_t> (std::floor (position.y / m_range));
+  return ((uint64_t) (uint32_t) cx << 32) | (uint32_t) cy;
+}
+
+void
+StealthContactTracker::Update (const std::vector<Vector> &positions, std::vector<Delta> &deltas)
+{
+  NS_LOG_FUNCTION (this << positions.size ());
+  deltas.clear ();
+  m_nEvaluated = 0;
+
+  // new nodes enter the grid and are always evaluated
+  uint32_t known = m_nodes.size ();
+  std::vector<bool> dirty (positions.size (), false);
+  m_nodes.resize (std::max<size_t> (known, positions.size ()));
+  for (uint32_t n = known; n < positions.size (); n++)
+    {
+      m_nodes[n].cell = GetCell (positions[n]);
+      m_cells[m_nodes[n].cell].push_back (n);
+      dirty[n] = true;
+    }
+
+  for (uint32_t n = 0; n < known && n < positions.size (); n++)
+    {
+      NodeState &state = m_nodes[n];
+      uint64_t cell = GetCell (positions[n]);
+      if (cell != state.cell)
+        {
+          Remove (m_cells[state.cell], n);
+          Insert (m_cells[cell], n);
+          state.cell = cell;
+          dirty[n] = true;
+        }
+      else if (CalculateDistance (positions[n], state.evaluated) > m_moveThreshold)
+        {
+          dirty[n] = true;
+        }
+    }
+
+  for (uint32_t n = 0; n < positions.size (); n++)
+    {
+      if (dirty[n])
+        {
+          Evaluate (n, positions, deltas);
+          m_nEvaluated++;
+        }
+    }
+  NS_LOG_LOGIC ("Evaluated " << m_nEvaluated << " of " << positions.size () << " nodes, "
+                << deltas.size () << " deltas");
+}
+
+void
+StealthContactTracker::Evaluate (uint32_t node, const std::vector<Vector> &positions,
+                                 std::vector<Delta> &deltas)
+{
+  NodeState &state = m_nodes[node];
+  state.evaluated = positions[node];
+
+  // nodes of the 3x3 cells around the node, in range
+  m_candidates.clear ();
+  int32_t cx = static_cast<int32_t> (state.cell >> 32);
+  int32_t cy = static_cast<int32_t> (state.cell & 0xffffffff);
+  for (int32_t dx = -1; dx <= 1; dx++)
+    {
+      for (int32_t dy = -1; dy <= 1; dy++)
+        {
+          uint64_t cell = ((uint64_t) (uint32_t) (cx + dx) << 32) | (uint32_t) (cy + dy);
+          std::map<uint64_t, std::vector<uint32_t> >::const_iterator i = m_cells.find (cell);
+          if (i == m_cells.end ())
+            {
+              continue;
+            }
+          for (std::vector<uint32_t>::const_iterator j = i->second.begin (); j != i->second.end (); j++)
+            {
+              if (*j != node && *j < positions.size ()
+                  && CalculateDistance (positions[node], positions[*j]) <= m_range)
+                {
+                  m_candidates.push_back (*j);
+                }
+            }
+        }
+    }
+  std::sort (m_candidates.begin (), m_candidates.end ());
+
+  // merge the sorted old and new contact lists
+  std::vector<uint32_t> old = state.contacts;
+  std::vector<uint32_t>::const_iterator o = old.begin ();
+  std::vector<uint32_t>::const_iterator c = m_candidates.begin ();
+  while (o != old.end () || c != m_candidates.end ())
+    {
+      if (c == m_candidates.end () || (o != old.end () && *o < *c))
+        {
+          Delta delta = { std::min (node, *o), std::max (node, *o), false };
+          deltas.push_back (delta);
+          Remove (state.contacts, *o);
+          Remove (m_nodes[*o].contacts, node);
+          o++;
+        }
+      else if (o == old.end () || *c < *o)
+        {
+          Delta delta = { std::min (node, *c), std::max (node, *c), true };
+          deltas.push_back (delta);
+          Insert (state.contacts, *c);
+          Insert (m_nodes[*c].contacts, node);
+          c++;
+        }
+      else
+        {
+          o++;
+          c++;
+        }
+    }
+}
+
+const std::vector<uint32_t> &
+StealthContactTracker::GetContacts (uint32_t node) const
+{
+  NS_ASSERT (node < m_nodes.size ());
+  return m_nodes[node].contacts;
+}
+
+bool
+StealthContactTracker::IsInContact (uint32_t a, uint32_t b) const
+{
+  if (a >= m_nodes.size ())
+    {
+      return false;
+    }
+  const std::vector<uint32_t> &contacts = m_nodes[a].contacts;
+  return std::binary_search (contacts.begin (), contacts.end (), b);
+}
+
+uint32_t
+StealthContactTracker::GetNEvaluated (void) const
+{
+  return m_nEvaluated;
+}
+
+void
+StealthContactTracker::Insert (std::vector<uint32_t> &contacts, uint32_t node)
+{
+  std::vector<uint32_t>::iterator i = std::lower_bound (contacts.begin (), contacts.end (), node);
+  if (i == contacts.end () || *i != node)
+    {
+      contacts.insert (i, node);
+    }
+}
+
+void
+StealthContactTracker::Remove (std::vector<uint32_t> &contacts, uint32_t node)
+{
+  std::vector<uint32_t>::iterator i = std::lower_bound (contacts.begin (), contacts.end (), node);
+  if (i != contacts.end () && *i == node)
+    {
+      contacts.erase (i);
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,125 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * STEALTH Project (2019)
+ */
+
+#ifndef STEALTH_CONTACT_TRACKER_H
+#define STEALTH_CONTACT_TRACKER_H
+
+#include <vector>
+#include <map>
+
+#include "ns3/vector.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup mobility
+ *
+ * \brief Incremental tracker of the node pairs within radio range.
+ *
+ * Nodes are kept in a grid of range-sized cells. At each update only the
+ * nodes that crossed a cell boundary or moved more than the move threshold
+ * since they were last evaluated have their contacts recomputed, against
+ * the nodes of the 3x3 surrounding cells; the others keep their contacts.
+ * In slow crowds most nodes are skipped at every step.
+ *
+ * The price is accuracy: the distance of a pair is off by at most three
+ * times the move threshold when its status is decided. A null threshold
+ * gives exact contacts for the nodes evaluated at each step.
+ */
+class StealthContactTracker
+{
+public:
+  /// A contact starting or ending
+  struct Delta
+  {
+    uint32_t a;     //!< the node with the smaller index
+    uint32_t b;     //!< the node with the bigger index
+    bool start;     //!< true if the contact starts, false if it ends
+  };
+
+  /**
+   * \param range the contact range, in meters
+   * \param moveThreshold the displacement triggering a re-evaluation
+   */
+  StealthContactTracker (double range, double moveThreshold);
+
+  /**
+   * \param positions the position of every node, by node index
+   * \param deltas receives the contacts started and ended since the
+   *        previous update, by increasing node index
+   */
+  void Update (const std::vector<Vector> &positions, std::vector<Delta> &deltas);
+
+  /**
+   * \param node a node index
+   * \returns the nodes in contact with the node, in increasing order
+   */
+  const std::vector<uint32_t> &GetContacts (uint32_t node) const;
+  /**
+   * \param a a node index
+   * \param b another node index
+   * \returns true if the nodes are in contact
+   */
+  bool IsInContact (uint32_t a, uint32_t b) const;
+  /**
+   * \returns the number of nodes re-evaluated by the last update
+   */
+  uint32_t GetNEvaluated (void) const;
+
+private:
+  /// Tracked state of a node
+  struct NodeState
+  {
+    Vector evaluated;                 //!< position at the last evaluation
+    uint64_t cell;                    //!< current grid cell
+    std::vector<uint32_t> contacts;   //!< nodes in contact, sorted
+  };
+
+  /**
+   * \param position a position
+   * \returns the key of the grid cell holding the position
+   */
+  uint64_t GetCell (const Vector &position) const;
+  /**
+   * \param node a node index
+   * \param positions the position of every node
+   * \param deltas receives the contacts started and ended
+   */
+  void Evaluate (uint32_t node, const std::vector<Vector> &positions, std::vector<Delta> &deltas);
+  /**
+   * \param contacts a sorted contact list
+   * \param node the node to insert
+   */
+  static void Insert (std::vector<uint32_t> &contacts, uint32_t node);
+  /**
+   * \param contacts a sorted contact list
+   * \param node the node to remove
+   */
+  static void Remove (std::vector<uint32_t> &contacts, uint32_t node);
+
+  double m_range;                                       //!< contact range
+  double m_moveThreshold;                               //!< re-evaluation displacement
+  std::vector<NodeState> m_nodes;                       //!< state of each node
+  std::map<uint64_t, std::vector<uint32_t> > m_cells;   //!< nodes of each grid cell
+  std::vector<uint32_t> m_candidates;                   //!< scratch list of nearby nodes
+  uint32_t m_nEvaluated;                                //!< nodes evaluated by the last update
+};
+
+} // namespace ns3
+
+#endif /* STEALTH_CONTACT_TRACKER_H */
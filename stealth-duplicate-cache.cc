@@ -0,0 +1,151 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * STEALTH Project (2019)
+ */
+
+#include "stealth-duplicate-cache.h"
+#include "ns3/log.h"
+#include "ns3/assert.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("StealthDuplicateCache");
+
+StealthDuplicateCache::StealthDuplicateCache (uint32_t bits, uint32_t hashes, Time window)
+{
+  NS_LOG_FUNCTION (this << bits << hashes << window);
+  Configure (bits, hashes, window);
+}
+
+void
+StealthDuplicateCache::Configure (uint32_t bits, uint32_t hashes, Time window)
+{
+  NS_LOG_FUNCTION (this << bits << hashes << window);
+  NS_ASSERT_MSG (bits > 0 && hashes > 0, "Empty duplicate cache");
+  uint32_t words = (bits + 63) / 64;
+  m_bits = words * 64;
+  m_hashes = hashes;
+  m_window = window;
+  m_lastRotation = Seconds (0.0);
+  m_current.assign (words, 0);
+  m_previous.assign (words, 0);
+}
+
+bool
+StealthDuplicateCache::CheckAndInsert (uint64_t key, Time now)
+{
+  NS_LOG_FUNCTION (this << key << now);
+  if (m_current.empty ())
+    {
+      // released: start again with empty filters
+      Configure (m_bits, m_hashes, m_window);
+    }
+  Expire (now);
+  if (Test (m_current, key))
+    {
+      return true;
+    }
+  bool seen = Test (m_previous, key);
+  for (uint32_t i = 0; i < m_hashes; i++)
+    {
+      uint32_t bit = Hash (key, i);
+      m_current[bit / 64] |= (uint64_t) 1 << (bit % 64);
+    }
+  return seen;
+}
+
+bool
+StealthDuplicateCache::Contains (uint64_t key, Time now)
+{
+  NS_LOG_FUNCTION (this << key << now);
+  if (m_current.empty ())
+    {
+      return false;
+    }
+  Expire (now);
+  return Test (m_current, key) || Test (m_previous, key);
+}
+
+void
+StealthDuplicateCache::Clear (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_current.assign (m_current.size (), 0);
+  m_previous.assign (m_previous.size (), 0);
+}
+
+void
+StealthDuplicateCache::Release (void)
+{
+  NS_LOG_FUNCTION (this);
+  std::vector<uint64_t> ().swap (m_current);
+  std::vector<uint64_t> ().swap (m_previous);
+}
+
+uint64_t
+StealthDuplicateCache::GetMemoryUsage (void) const
+{
+  return (m_current.capacity () + m_previous.capacity ()) * sizeof (uint64_t);
+}
+
+void
+StealthDuplicateCache::Expire (Time now)
+{
+  if (now - m_lastRotation < m_window)
+    {
+      return;
+    }
+  if (now - m_lastRotation >= m_window + m_window)
+    {
+      // nothing inserted during the last window survives either
+      m_previous.assign (m_previous.size (), 0);
+    }
+  else
+    {
+      m_previous.swap (m_current);
+    }
+  m_current.assign (m_current.size (), 0);
+  m_lastRotation = now;
+}
+
+bool
+StealthDuplicateCache::Test (const std::vector<uint64_t> &filter, uint64_t key) const
+{
+  for (uint32_t i = 0; i < m_hashes; i++)
+    {
+      uint32_t bit = Hash (key, i);
+      if ((filter[bit / 64] & ((uint64_t) 1 << (bit % 64))) == 0)
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+uint32_t
+StealthDuplicateCache::Hash (uint64_t key, uint32_t i) const
+{
+  // double hashing over a 64 bit mix (splitmix64 finalizer)
+  uint64_t h = key + 0x9e3779b97f4a7c15ULL;
+  h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+  h = h ^ (h >> 31);
+  uint32_t h1 = h & 0xffffffff;
+  uint32_t h2 = (h >> 32) | 1;
+  return (h1 + i * h2) % m_bits;
+}
+
+} // namespace ns3
@@ -0,0 +1,119 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * STEALTH Project (2019)
+ */
+
+#ifndef STEALTH_DUPLICATE_CACHE_H
+#define STEALTH_DUPLICATE_CACHE_H
+
+#include <vector>
+
+#include "ns3/nstime.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup network
+ *
+ * \brief Bounded, time-windowed duplicate detector for flooded messages.
+ *
+ * Two Bloom filters of fixed size are kept: keys are inserted in the
+ * current one and looked up in both. Every window the current filter
+ * becomes the previous one and a cleared filter takes its place, so a key
+ * is remembered for at least one window and at most two. Memory does not
+ * depend on the number of messages; the price is a small false positive
+ * probability, set by the number of bits and hash functions.
+ */
+class StealthDuplicateCache
+{
+public:
+  /**
+   * \param bits the size of each filter, in bits (rounded up to 64)
+   * \param hashes the number of hash functions
+   * \param window the rotation period
+   */
+  StealthDuplicateCache (uint32_t bits = 4096, uint32_t hashes = 3, Time window = Seconds (10.0));
+
+  /**
+   * \param bits the size of each filter, in bits (rounded up to 64)
+   * \param hashes the number of hash functions
+   * \param window the rotation period
+   *
+   * Resize the filters and forget every key.
+   */
+  void Configure (uint32_t bits, uint32_t hashes, Time window);
+
+  /**
+   * \param key the message key
+   * \param now the current time
+   * \returns true if the key was already seen within the window;
+   *          the key is recorded as seen in either case.
+   */
+  bool CheckAndInsert (uint64_t key, Time now);
+
+  /**
+   * \param key the message key
+   * \param now the current time
+   * \returns true if the key was already seen within the window
+   */
+  bool Contains (uint64_t key, Time now);
+
+  /**
+   * \brief Forget every key.
+   */
+  void Clear (void);
+
+  /**
+   * \brief Free the filters and forget every key. The filters are
+   * allocated again by the next CheckAndInsert.
+   */
+  void Release (void);
+
+  /**
+   * \returns the bytes allocated on the heap by the filters
+   */
+  uint64_t GetMemoryUsage (void) const;
+
+private:
+  /**
+   * \brief Rotate the filters if a window has elapsed.
+   * \param now the current time
+   */
+  void Expire (Time now);
+  /**
+   * \param filter the filter to look into
+   * \param key the message key
+   * \returns true if all bits of the key are set in the filter
+   */
+  bool Test (const std::vector<uint64_t> &filter, uint64_t key) const;
+  /**
+   * \param key the message key
+   * \param i the hash function index
+   * \returns the bit index of the i-th hash of the key
+   */
+  uint32_t Hash (uint64_t key, uint32_t i) const;
+
+  std::vector<uint64_t> m_current;   //!< filter receiving new keys
+  std::vector<uint64_t> m_previous;  //!< filter of the previous window
+  uint32_t m_bits;                   //!< bits per filter
+  uint32_t m_hashes;                 //!< number of hash functions
+  Time m_window;                     //!< rotation period
+  Time m_lastRotation;               //!< time of the last rotation
+};
+
+} // namespace ns3
+
+#endif /* STEALTH_DUPLICATE_CACHE_H */
@@ -0,0 +1,563 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * STEALTH Project (2019)
+ */
+
+#include <cstring>
+
+#include "stealth-header.h"
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/abort.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("StealthHeader");
+
+NS_OBJECT_ENSURE_REGISTERED (StealthHeader);
+NS_OBJECT_ENSURE_REGISTERED (StealthTag);
+
+/**
+ * \brief Interned competence names, indexed by competence id.
+ * \returns the competence registry
+ */
+static std::vector<std::string> &
+GetCompetenceRegistry (void)
+{
+  static std::vector<std::string> registry;
+  return registry;
+}
+
+/**
+ * \brief Interned interest names, indexed by interest bit.
+ * \returns the interest registry
+ */
+static std::vector<std::string> &
+GetInterestRegistry (void)
+{
+  static std::vector<std::string> registry;
+  return registry;
+}
+
+StealthHeader::StealthHeader ()
+  : m_type (HELLO),
+    m_competence (0),
+    m_priority (0),
+    m_criticalDataSize (0),
+    m_interests (0),
+    m_origin (0),
+    m_sequence (0),
+    m_hopLimit (0),
+    m_load (0),
+    m_nTrustReports (0)
+{
+  std::memset (m_responderHops, NO_ROUTE, MAX_ROUTED_COMPETENCES);
+}
+
+TypeId
+StealthHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::StealthHeader")
+    .SetParent<Header> ()
+    .SetGroupName ("Network")
+    .AddConstructor<StealthHeader> ()
+  ;
+  return tid;
+}
+
+TypeId
+StealthHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+void
+StealthHeader::Print (std::ostream &os) const
+{
+  os << "type=" << (m_type == HELLO ? "HELLO" : "EMERGENCY")
+     << " competence=" << GetCompetenceName (m_competence)
+     << " interests=0x" << std::hex << m_interests << std::dec
+     << " origin=" << m_origin
+     << " sequence=" << m_sequence
+     << " hopLimit=" << (uint32_t) m_hopLimit
+     << " load=" << (uint32_t) m_load
+     << " priority=" << (uint32_t) m_priority
+     << " trustReports=" << (uint32_t) m_nTrustReports
+     << " criticalData=" << (uint32_t) m_criticalDataSize << "B";
+}
+
+uint32_t
+StealthHeader::GetSerializedSize (void) const
+{
+  return 23 + MAX_ROUTED_COMPETENCES + 6 * m_nTrustReports + m_criticalDataSize;
+}
+
+void
+StealthHeader::Serialize (Buffer::Iterator start) const
+{
+  Buffer::Iterator i = start;
+  i.WriteU8 (m_type);
+  i.WriteU8 (m_competence);
+  i.WriteU8 (m_priority);
+  i.WriteU8 (m_criticalDataSize);
+  i.WriteHtonU64 (m_interests);
+  i.WriteHtonU32 (m_origin);
+  i.WriteHtonU32 (m_sequence);
+  i.WriteU8 (m_hopLimit);
+  i.WriteU8 (m_load);
+  i.Write (m_responderHops, MAX_ROUTED_COMPETENCES);
+  i.WriteU8 (m_nTrustReports);
+  for (uint8_t r = 0; r < m_nTrustReports; r++)
+    {
+      i.WriteHtonU32 (m_trustSubjects[r]);
+      i.WriteHtonU16 (m_trustValues[r]);
+    }
+  i.Write (m_criticalData, m_criticalDataSize);
+}
+
+uint32_t
+StealthHeader::Deserialize (Buffer::Iterator start)
+{
+  Buffer::Iterator i = start;
+  m_type = i.ReadU8 ();
+  m_competence = i.ReadU8 ();
+  m_priority = i.ReadU8 ();
+  m_criticalDataSize = i.ReadU8 ();
+  m_interests = i.ReadNtohU64 ();
+  m_origin = i.ReadNtohU32 ();
+  m_sequence = i.ReadNtohU32 ();
+  m_hopLimit = i.ReadU8 ();
+  m_load = i.ReadU8 ();
+  i.Read (m_responderHops, MAX_ROUTED_COMPETENCES);
+  uint8_t reports = i.ReadU8 ();
+  m_nTrustReports = reports > MAX_TRUST_REPORTS ? (uint8_t) MAX_TRUST_REPORTS : reports;
+  for (uint8_t r = 0; r < m_nTrustReports; r++)
+    {
+      m_trustSubjects[r] = i.ReadNtohU32 ();
+      m_trustValues[r] = i.ReadNtohU16 ();
+    }
+  if (reports > MAX_TRUST_REPORTS)
+    {
+      NS_LOG_WARN ("Ignoring " << (uint32_t) (reports - MAX_TRUST_REPORTS) << " trust reports");
+      i.Next (6 * (reports - MAX_TRUST_REPORTS));
+    }
+  uint32_t size = 23 + MAX_ROUTED_COMPETENCES + 6 * reports + m_criticalDataSize;
+  if (m_criticalDataSize > MAX_CRITICAL_DATA)
+    {
+      NS_LOG_WARN ("Truncating critical data of " << (uint32_t) m_criticalDataSize << " bytes");
+      i.Read (m_criticalData, MAX_CRITICAL_DATA);
+      i.Next (m_criticalDataSize - MAX_CRITICAL_DATA);
+      m_criticalDataSize = MAX_CRITICAL_DATA;
+      return size;
+    }
+  i.Read (m_criticalData, m_criticalDataSize);
+  return size;
+}
+
+void
+StealthHeader::SetMessageType (MessageType type)
+{
+  m_type = type;
+}
+
+StealthHeader::MessageType
+StealthHeader::GetMessageType (void) const
+{
+  return MessageType (m_type);
+}
+
+void
+StealthHeader::SetCompetence (uint8_t competence)
+{
+  m_competence = competence;
+}
+
+uint8_t
+StealthHeader::GetCompetence (void) const
+{
+  return m_competence;
+}
+
+void
+StealthHeader::SetInterests (uint64_t interests)
+{
+  m_interests = interests;
+}
+
+uint64_t
+StealthHeader::GetInterests (void) const
+{
+  return m_interests;
+}
+
+void
+StealthHeader::SetOrigin (uint32_t origin)
+{
+  m_origin = origin;
+}
+
+uint32_t
+StealthHeader::GetOrigin (void) const
+{
+  return m_origin;
+}
+
+void
+StealthHeader::SetSequence (uint32_t sequence)
+{
+  m_sequence = sequence;
+}
+
+uint32_t
+StealthHeader::GetSequence (void) const
+{
+  return m_sequence;
+}
+
+void
+StealthHeader::SetPriority (uint8_t priority)
+{
+  m_priority = priority;
+}
+
+uint8_t
+StealthHeader::GetPriority (void) const
+{
+  return m_priority;
+}
+
+void
+StealthHeader::SetHopLimit (uint8_t hopLimit)
+{
+  m_hopLimit = hopLimit;
+}
+
+uint8_t
+StealthHeader::GetHopLimit (void) const
+{
+  return m_hopLimit;
+}
+
+bool
+StealthHeader::AddTrustReport (uint32_t subject, double trust)
+{
+  if (m_nTrustReports == MAX_TRUST_REPORTS)
+    {
+      return false;
+    }
+  // written as !(trust > 0) so that NaN is clamped too
+  if (!(trust > 0.0))
+    {
+      trust = 0.0;
+    }
+  else if (trust > 1.0)
+    {
+      trust = 1.0;
+    }
+  m_trustSubjects[m_nTrustReports] = subject;
+  m_trustValues[m_nTrustReports] = static_cast<uint16_t> (trust * 65535.0 + 0.5);
+  m_nTrustReports++;
+  return true;
+}
+
+void
+StealthHeader::ClearTrustReports (void)
+{
+  m_nTrustReports = 0;
+}
+
+uint8_t
+StealthHeader::GetNTrustReports (void) const
+{
+  return m_nTrustReports;
+}
+
+uint32_t
+StealthHeader::GetTrustReportSubject (uint8_t i) const
+{
+  NS_ASSERT (i < m_nTrustReports);
+  return m_trustSubjects[i];
+}
+
+double
+StealthHeader::GetTrustReportTrust (uint8_t i) const
+{
+  NS_ASSERT (i < m_nTrustReports);
+  return m_trustValues[i] / 65535.0;
+}
+
+void
+StealthHeader::SetLoad (uint8_t load)
+{
+  m_load = load;
+}
+
+uint8_t
+StealthHeader::GetLoad (void) const
+{
+  return m_load;
+}
+
+void
+StealthHeader::SetResponderHops (uint8_t competence, uint8_t hops)
+{
+  if (competence < MAX_ROUTED_COMPETENCES)
+    {
+      m_responderHops[competence] = hops;
+    }
+}
+
+uint8_t
+StealthHeader::GetResponderHops (uint8_t competence) const
+{
+  if (competence >= MAX_ROUTED_COMPETENCES)
+    {
+      return NO_ROUTE;
+    }
+  return m_responderHops[competence];
+}
+
+void
+StealthHeader::SetCriticalData (uint8_t const *data, uint8_t size)
+{
+  NS_ABORT_MSG_IF (size > MAX_CRITICAL_DATA, "Critical data of " << (uint32_t) size <<
+                   " bytes exceeds " << (uint32_t) MAX_CRITICAL_DATA << " bytes");
+  std::memcpy (m_criticalData, data, size);
+  m_criticalDataSize = size;
+}
+
+void
+StealthHeader::SetCriticalData (std::string data)
+{
+  NS_ABORT_MSG_IF (data.size () > MAX_CRITICAL_DATA, "Critical data \"" << data <<
+                   "\" exceeds " << (uint32_t) MAX_CRITICAL_DATA << " bytes");
+  SetCriticalData (reinterpret_cast<uint8_t const *> (data.data ()), data.size ());
+}
+
+uint8_t const *
+StealthHeader::GetCriticalData (void) const
+{
+  return m_criticalData;
+}
+
+uint8_t
+StealthHeader::GetCriticalDataSize (void) const
+{
+  return m_criticalDataSize;
+}
+
+std::string
+StealthHeader::GetCriticalDataString (void) const
+{
+  return std::string (reinterpret_cast<char const *> (m_criticalData), m_criticalDataSize);
+}
+
+uint8_t
+StealthHeader::GetCompetenceId (std::string competence)
+{
+  std::vector<std::string> &registry = GetCompetenceRegistry ();
+  for (uint32_t i = 0; i < registry.size (); i++)
+    {
+      if (registry[i] == competence)
+        {
+          return i;
+        }
+    }
+  NS_ABORT_MSG_IF (registry.size () > 255, "Too many distinct competences");
+  registry.push_back (competence);
+  return registry.size () - 1;
+}
+
+bool
+StealthHeader::FindCompetenceId (std::string competence, uint8_t &id)
+{
+  const std::vector<std::string> &registry = GetCompetenceRegistry ();
+  for (uint32_t i = 0; i < registry.size (); i++)
+    {
+      if (registry[i] == competence)
+        {
+          id = i;
+          return true;
+        }
+    }
+  return false;
+}
+
+const std::string &
+StealthHeader::GetCompetenceName (uint8_t id)
+{
+  static const std::string unknown = "unknown";
+  std::vector<std::string> &registry = GetCompetenceRegistry ();
+  if (id >= registry.size ())
+    {
+      return unknown;
+    }
+  return registry[id];
+}
+
+uint8_t
+StealthHeader::GetInterestBit (std::string interest)
+{
+  uint8_t bit;
+  NS_ABORT_MSG_IF (!TryGetInterestBit (interest, bit), "More than " << (uint32_t) MAX_INTERESTS <<
+                   " distinct interests");
+  return bit;
+}
+
+bool
+StealthHeader::TryGetInterestBit (std::string interest, uint8_t &bit)
+{
+  if (FindInterestBit (interest, bit))
+    {
+      return true;
+    }
+  std::vector<std::string> &registry = GetInterestRegistry ();
+  if (registry.size () >= MAX_INTERESTS)
+    {
+      return false;
+    }
+  registry.push_back (interest);
+  bit = registry.size () - 1;
+  return true;
+}
+
+bool
+StealthHeader::FindInterestBit (std::string interest, uint8_t &bit)
+{
+  const std::vector<std::string> &registry = GetInterestRegistry ();
+  for (uint32_t i = 0; i < registry.size (); i++)
+    {
+      if (registry[i] == interest)
+        {
+          bit = i;
+          return true;
+        }
+    }
+  return false;
+}
+
+const std::string &
+StealthHeader::GetInterestName (uint8_t bit)
+{
+  static const std::string unknown = "unknown";
+  std::vector<std::string> &registry = GetInterestRegistry ();
+  if (bit >= registry.size ())
+    {
+      return unknown;
+    }
+  return registry[bit];
+}
+
+uint64_t
+StealthHeader::GetInterestBitset (const std::vector<std::string> &interests)
+{
+  uint64_t bitset = 0;
+  for (std::vector<std::string>::const_iterator i = interests.begin ();
+       i != interests.end (); i++)
+    {
+      bitset |= (uint64_t) 1 << GetInterestBit (*i);
+    }
+  return bitset;
+}
+
+std::vector<std::string>
+StealthHeader::GetInterestNames (uint64_t interests)
+{
+  std::vector<std::string> names;
+  for (uint8_t bit = 0; bit < MAX_INTERESTS; bit++)
+    {
+      if (interests & ((uint64_t) 1 << bit))
+        {
+          names.push_back (GetInterestName (bit));
+        }
+    }
+  return names;
+}
+
+StealthTag::StealthTag ()
+  : m_origin (0),
+    m_sequence (0)
+{
+}
+
+StealthTag::StealthTag (uint32_t origin, uint32_t sequence)
+  : m_origin (origin),
+    m_sequence (sequence)
+{
+}
+
+TypeId
+StealthTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::StealthTag")
+    .SetParent<Tag> ()
+    .SetGroupName ("Network")
+    .AddConstructor<StealthTag> ()
+  ;
+  return tid;
+}
+
+TypeId
+StealthTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+uint32_t
+StealthTag::GetSerializedSize (void) const
+{
+  return 8;
+}
+
+void
+StealthTag::Serialize (TagBuffer i) const
+{
+  i.WriteU32 (m_origin);
+  i.WriteU32 (m_sequence);
+}
+
+void
+StealthTag::Deserialize (TagBuffer i)
+{
+  m_origin = i.ReadU32 ();
+  m_sequence = i.ReadU32 ();
+}
+
+void
+StealthTag::Print (std::ostream &os) const
+{
+  os << "origin=" << m_origin << " sequence=" << m_sequence;
+}
+
+uint32_t
+StealthTag::GetOrigin (void) const
+{
+  return m_origin;
+}
+
+uint32_t
+StealthTag::GetSequence (void) const
+{
+  return m_sequence;
+}
+
+uint64_t
+StealthTag::GetKey (void) const
+{
+  return ((uint64_t) m_origin << 32) | m_sequence;
+}
+
+} // namespace ns3
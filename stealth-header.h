@@ -0,0 +1,372 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * STEALTH Project (2019)
+ */
+
+#ifndef STEALTH_HEADER_H
+#define STEALTH_HEADER_H
+
+#include <vector>
+#include <string>
+
+#include "ns3/header.h"
+#include "ns3/tag.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup network
+ *
+ * \brief Fixed-layout header for STEALTH hello and emergency messages.
+ *
+ * Competences and interests are interned into small integer ids shared
+ * by every node of the simulation, so the header carries a competence id
+ * and an interest bitset instead of strings. Deserialization reads the
+ * fields straight from the packet buffer and never allocates: the critical
+ * data is an opaque slice stored inline, limited to MAX_CRITICAL_DATA bytes.
+ *
+ * Wire layout (network byte order):
+ * \verbatim
+   0        1        2        3
+   +--------+--------+--------+--------+
+   |  type  | compet.|priority| dataLen|
+   +--------+--------+--------+--------+
+   |         interests (64 bits)       |
+   |                                   |
+   +--------+--------+--------+--------+
+   |              origin               |
+   +--------+--------+--------+--------+
+   |             sequence              |
+   +--------+--------+--------+--------+
+   |hopLimit|  load  | hops 0 | hops 1 |
+   +--------+--------+--------+--------+
+   | hops 2 |  ...   |  ...   | hops 5 |
+   +--------+--------+--------+--------+
+   | hops 6 | hops 7 | reports| report 0 subject ...
+   +--------+--------+--------+--------+
+   |      ...        |  report 0 trust |
+   +--------+--------+--------+--------+ ... (6 bytes per report)
+   | critical data ...
+   +--------+
+   \endverbatim
+ *
+ * The (origin, sequence) pair identifies an emergency message across
+ * relays; it is mirrored in a StealthTag so that duplicates can be
+ * detected by the Node before any protocol handler runs.
+ *
+ * "hops c" is the number of hops from the sender to the nearest responder
+ * with competence id c it knows of (NO_ROUTE if none), for the first
+ * MAX_ROUTED_COMPETENCES competence ids. Hellos advertise them so that
+ * emergencies can be forwarded greedily toward a responder, within the
+ * hop limit carried by the emergency. "load" is the pending attending
+ * load of the sender, used to spread emergencies among responders.
+ * Hellos also carry up to MAX_TRUST_REPORTS trust reports: the node ids
+ * the sender trusts most, with its trust in them, gossiped to build the
+ * reputation of nodes beyond the local view.
+ */
+class StealthHeader : public Header
+{
+public:
+  /// Message types carried by the header
+  enum MessageType
+  {
+    HELLO = 1,      //!< neighbor discovery broadcast
+    EMERGENCY = 2   //!< emergency request with critical data
+  };
+
+  /// Maximum size of the critical data slice, in bytes
+  static const uint8_t MAX_CRITICAL_DATA = 32;
+  /// Maximum number of distinct interests (bits of the interest bitset)
+  static const uint8_t MAX_INTERESTS = 64;
+  /// Number of competence ids whose responder distance is advertised
+  static const uint8_t MAX_ROUTED_COMPETENCES = 8;
+  /// Responder distance meaning no responder is known
+  static const uint8_t NO_ROUTE = 255;
+  /// Maximum number of trust reports carried by a hello
+  static const uint8_t MAX_TRUST_REPORTS = 4;
+
+  StealthHeader ();
+
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual void Print (std::ostream &os) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+
+  /**
+   * \param type the message type
+   */
+  void SetMessageType (MessageType type);
+  /**
+   * \returns the message type
+   */
+  MessageType GetMessageType (void) const;
+
+  /**
+   * \param competence the interned competence id, see GetCompetenceId
+   */
+  void SetCompetence (uint8_t competence);
+  /**
+   * \returns the interned competence id
+   */
+  uint8_t GetCompetence (void) const;
+
+  /**
+   * \param interests the interest bitset, see GetInterestBitset
+   */
+  void SetInterests (uint64_t interests);
+  /**
+   * \returns the interest bitset
+   */
+  uint64_t GetInterests (void) const;
+
+  /**
+   * \param origin the id of the node that originated the message
+   */
+  void SetOrigin (uint32_t origin);
+  /**
+   * \returns the id of the node that originated the message
+   */
+  uint32_t GetOrigin (void) const;
+
+  /**
+   * \param sequence the per-origin message sequence number
+   */
+  void SetSequence (uint32_t sequence);
+  /**
+   * \returns the per-origin message sequence number
+   */
+  uint32_t GetSequence (void) const;
+
+  /**
+   * \param priority the service priority (0,1,2,3)
+   */
+  void SetPriority (uint8_t priority);
+  /**
+   * \returns the service priority
+   */
+  uint8_t GetPriority (void) const;
+
+  /**
+   * \param hopLimit the number of hops an emergency may still travel
+   */
+  void SetHopLimit (uint8_t hopLimit);
+  /**
+   * \returns the number of hops an emergency may still travel
+   */
+  uint8_t GetHopLimit (void) const;
+
+  /**
+   * \param load the pending attending load of the sender, see
+   *        Node::GetPendingLoad
+   */
+  void SetLoad (uint8_t load);
+  /**
+   * \returns the pending attending load of the sender
+   */
+  uint8_t GetLoad (void) const;
+
+  /**
+   * \param competence an interned competence id
+   * \param hops the number of hops to the nearest responder with that
+   *        competence, or NO_ROUTE
+   */
+  void SetResponderHops (uint8_t competence, uint8_t hops);
+  /**
+   * \param competence an interned competence id
+   * \returns the number of hops to the nearest responder with that
+   *          competence, or NO_ROUTE
+   */
+  uint8_t GetResponderHops (uint8_t competence) const;
+
+  /**
+   * \param subject the id of the node the report is about
+   * \param trust the trust of the sender in that node, clamped to [0,1].
+   *        It is quantized to 16 bits on the wire.
+   * \returns false if the header already holds MAX_TRUST_REPORTS reports
+   */
+  bool AddTrustReport (uint32_t subject, double trust);
+  /**
+   * \brief Remove every trust report.
+   */
+  void ClearTrustReports (void);
+  /**
+   * \returns the number of trust reports
+   */
+  uint8_t GetNTrustReports (void) const;
+  /**
+   * \param i a report index
+   * \returns the id of the node the report is about
+   */
+  uint32_t GetTrustReportSubject (uint8_t i) const;
+  /**
+   * \param i a report index
+   * \returns the reported trust, in [0,1]
+   */
+  double GetTrustReportTrust (uint8_t i) const;
+
+  /**
+   * \param data the critical data bytes
+   * \param size the number of bytes, at most MAX_CRITICAL_DATA
+   */
+  void SetCriticalData (uint8_t const *data, uint8_t size);
+  /**
+   * \param data the critical data, at most MAX_CRITICAL_DATA characters
+   */
+  void SetCriticalData (std::string data);
+  /**
+   * \returns a pointer to the critical data slice, valid as long as
+   *          this header is alive
+   */
+  uint8_t const *GetCriticalData (void) const;
+  /**
+   * \returns the size of the critical data slice, in bytes
+   */
+  uint8_t GetCriticalDataSize (void) const;
+  /**
+   * \returns a copy of the critical data as a string
+   */
+  std::string GetCriticalDataString (void) const;
+
+  /**
+   * \param competence a competence name
+   * \returns the interned id of that competence. Ids are assigned on first
+   *          use and shared by all nodes of the simulation.
+   */
+  static uint8_t GetCompetenceId (std::string competence);
+  /**
+   * \param competence a competence name
+   * \param id receives the interned id of that competence
+   * \returns false if no node ever used that competence. Unlike
+   *          GetCompetenceId, the competence is never assigned an id.
+   */
+  static bool FindCompetenceId (std::string competence, uint8_t &id);
+  /**
+   * \param id an interned competence id
+   * \returns the competence name
+   */
+  static const std::string &GetCompetenceName (uint8_t id);
+  /**
+   * \param interest an interest name
+   * \returns the bit index of that interest in the interest bitset
+   *
+   * Aborts when the MAX_INTERESTS bits are all taken by other interests.
+   */
+  static uint8_t GetInterestBit (std::string interest);
+  /**
+   * \param interest an interest name
+   * \param bit receives the bit index of that interest
+   * \returns false if the interest has no bit and the MAX_INTERESTS bits
+   *          are all taken by other interests. Otherwise, as
+   *          GetInterestBit, the interest is assigned a bit if needed.
+   */
+  static bool TryGetInterestBit (std::string interest, uint8_t &bit);
+  /**
+   * \param interest an interest name
+   * \param bit receives the bit index of that interest
+   * \returns false if no node ever used that interest. Unlike
+   *          GetInterestBit, the interest is never assigned a bit.
+   */
+  static bool FindInterestBit (std::string interest, uint8_t &bit);
+  /**
+   * \param bit the bit index of an interest
+   * \returns the interest name
+   */
+  static const std::string &GetInterestName (uint8_t bit);
+  /**
+   * \param interests a list of interest names
+   * \returns the interest bitset of that list. Aborts as GetInterestBit.
+   */
+  static uint64_t GetInterestBitset (const std::vector<std::string> &interests);
+  /**
+   * \param interests an interest bitset
+   * \returns the list of interest names, by increasing bit index
+   */
+  static std::vector<std::string> GetInterestNames (uint64_t interests);
+
+private:
+  uint8_t m_type;                                 //!< message type
+  uint8_t m_competence;                           //!< interned competence id
+  uint8_t m_priority;                             //!< service priority
+  uint8_t m_criticalDataSize;                     //!< critical data size
+  uint64_t m_interests;                           //!< interest bitset
+  uint32_t m_origin;                              //!< originator node id
+  uint32_t m_sequence;                            //!< originator sequence number
+  uint8_t m_hopLimit;                             //!< remaining emergency hops
+  uint8_t m_load;                                 //!< sender pending attending load
+  uint8_t m_responderHops[MAX_ROUTED_COMPETENCES]; //!< hops to nearest responders
+  uint8_t m_nTrustReports;                        //!< number of trust reports
+  uint32_t m_trustSubjects[MAX_TRUST_REPORTS];    //!< trust report subjects
+  uint16_t m_trustValues[MAX_TRUST_REPORTS];      //!< quantized reported trusts
+  uint8_t m_criticalData[MAX_CRITICAL_DATA];      //!< critical data slice
+};
+
+/**
+ * \ingroup network
+ *
+ * \brief Packet tag identifying a STEALTH emergency message.
+ *
+ * Carries the (origin, sequence) pair of the StealthHeader so that
+ * Node::ReceiveFromDevice can suppress duplicate copies without
+ * parsing the packet.
+ */
+class StealthTag : public Tag
+{
+public:
+  StealthTag ();
+  /**
+   * \param origin the id of the node that originated the message
+   * \param sequence the per-origin message sequence number
+   */
+  StealthTag (uint32_t origin, uint32_t sequence);
+
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (TagBuffer i) const;
+  virtual void Deserialize (TagBuffer i);
+  virtual void Print (std::ostream &os) const;
+
+  /**
+   * \returns the id of the node that originated the message
+   */
+  uint32_t GetOrigin (void) const;
+  /**
+   * \returns the per-origin message sequence number
+   */
+  uint32_t GetSequence (void) const;
+  /**
+   * \returns the (origin, sequence) pair packed as a 64 bit key
+   */
+  uint64_t GetKey (void) const;
+
+private:
+  uint32_t m_origin;    //!< originator node id
+  uint32_t m_sequence;  //!< originator sequence number
+};
+
+} // namespace ns3
+
+#endif /* STEALTH_HEADER_H */
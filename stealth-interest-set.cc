@@ -0,0 +1,223 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * STEALTH Project (2019)
+ */
+
+#include <map>
+#include <algorithm>
+
+#include "stealth-interest-set.h"
+#include "stealth-header.h"
+#include "stealth-memory-monitor.h"
+#include "ns3/log.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("StealthInterestSet");
+
+/// Pool of sets indexed by their interest bitset
+typedef std::map<uint64_t, StealthInterestSet *> BitsetPool;
+
+/// Pool of the sets with extra interests, indexed by bitset and extra names
+typedef std::map<std::pair<uint64_t, std::vector<std::string> >, StealthInterestSet *> ExtraPool;
+
+/**
+ * \brief Get the pool of sets indexed by interest bitset.
+ * \returns the pool
+ */
+static BitsetPool &
+GetBitsetPool (void)
+{
+  // never destroyed, so sets released after static destruction are safe
+  static BitsetPool *pool = new BitsetPool ();
+  return *pool;
+}
+
+/**
+ * \brief Get the pool of sets with extra interests.
+ * \returns the pool
+ */
+static ExtraPool &
+GetExtraPool (void)
+{
+  static ExtraPool *pool = new ExtraPool ();
+  return *pool;
+}
+
+Ptr<const StealthInterestSet>
+StealthInterestSet::Get (const std::vector<std::string> &interests)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  uint64_t bitset = 0;
+  std::vector<std::string> extra;
+  for (std::vector<std::string>::const_iterator i = interests.begin (); i != interests.end (); i++)
+    {
+      uint8_t bit;
+      if (StealthHeader::TryGetInterestBit (*i, bit))
+        {
+          bitset |= (uint64_t) 1 << bit;
+        }
+      else
+        {
+          extra.push_back (*i);
+        }
+    }
+  if (extra.empty ())
+    {
+      return Get (bitset);
+    }
+
+  std::sort (extra.begin (), extra.end ());
+  extra.erase (std::unique (extra.begin (), extra.end ()), extra.end ());
+  ExtraPool &pool = GetExtraPool ();
+  std::pair<uint64_t, std::vector<std::string> > key (bitset, extra);
+  ExtraPool::iterator i = pool.find (key);
+  if (i != pool.end ())
+    {
+      return Ptr<const StealthInterestSet> (i->second);
+    }
+  StealthInterestSet *set = new StealthInterestSet (bitset, extra);
+  pool[key] = set;
+  NS_LOG_LOGIC ("New interest set " << set << " with " << extra.size () << " extra interests");
+  return Ptr<const StealthInterestSet> (set, false);
+}
+
+Ptr<const StealthInterestSet>
+StealthInterestSet::Get (uint64_t bitset)
+{
+  NS_LOG_FUNCTION (bitset);
+  BitsetPool &pool = GetBitsetPool ();
+  BitsetPool::iterator i = pool.find (bitset);
+  if (i != pool.end ())
+    {
+      return Ptr<const StealthInterestSet> (i->second);
+    }
+  StealthInterestSet *set = new StealthInterestSet (bitset, std::vector<std::string> ());
+  pool[bitset] = set;
+  NS_LOG_LOGIC ("New interest set " << set << ", " << pool.size () << " in pool");
+  // the pool holds no reference: adopt the initial one
+  return Ptr<const StealthInterestSet> (set, false);
+}
+
+uint32_t
+StealthInterestSet::GetNSets (void)
+{
+  return GetBitsetPool ().size () + GetExtraPool ().size ();
+}
+
+uint32_t
+StealthInterestSet::GetNExtraSets (void)
+{
+  return GetExtraPool ().size ();
+}
+
+uint64_t
+StealthInterestSet::GetPoolMemoryUsage (void)
+{
+  // a map node holds the entry and about four pointers of tree links
+  const uint64_t link = 4 * sizeof (void *);
+  const BitsetPool &pool = GetBitsetPool ();
+  uint64_t usage = 0;
+  for (BitsetPool::const_iterator i = pool.begin (); i != pool.end (); i++)
+    {
+      usage += sizeof (BitsetPool::value_type) + link + i->second->GetMemoryUsage ();
+    }
+  // the key of an extra set holds another copy of its extra names
+  const ExtraPool &extraPool = GetExtraPool ();
+  for (ExtraPool::const_iterator i = extraPool.begin (); i != extraPool.end (); i++)
+    {
+      usage += sizeof (ExtraPool::value_type) + link + i->second->GetMemoryUsage ()
+        + StealthMemoryMonitor::GetHeapSize (i->first.second);
+      for (std::vector<std::string>::const_iterator n = i->first.second.begin ();
+           n != i->first.second.end (); n++)
+        {
+          usage += StealthMemoryMonitor::GetHeapSize (*n);
+        }
+    }
+  return usage;
+}
+
+StealthInterestSet::StealthInterestSet (uint64_t bitset, const std::vector<std::string> &extra)
+  : m_interests (StealthHeader::GetInterestNames (bitset)),
+    m_bitset (bitset),
+    m_nExtra (extra.size ())
+{
+  m_interests.insert (m_interests.end (), extra.begin (), extra.end ());
+}
+
+StealthInterestSet::~StealthInterestSet ()
+{
+  if (m_nExtra != 0)
+    {
+      ExtraPool &pool = GetExtraPool ();
+      std::pair<uint64_t, std::vector<std::string> > key (m_bitset,
+        std::vector<std::string> (m_interests.end () - m_nExtra, m_interests.end ()));
+      ExtraPool::iterator i = pool.find (key);
+      if (i != pool.end () && i->second == this)
+        {
+          pool.erase (i);
+        }
+      return;
+    }
+  BitsetPool &pool = GetBitsetPool ();
+  BitsetPool::iterator i = pool.find (m_bitset);
+  if (i != pool.end () && i->second == this)
+    {
+      pool.erase (i);
+    }
+}
+
+const std::vector<std::string> &
+StealthInterestSet::GetInterests (void) const
+{
+  return m_interests;
+}
+
+uint64_t
+StealthInterestSet::GetBitset (void) const
+{
+  return m_bitset;
+}
+
+bool
+StealthInterestSet::HasExtraInterests (void) const
+{
+  return m_nExtra != 0;
+}
+
+uint64_t
+StealthInterestSet::GetMemoryUsage (void) const
+{
+  uint64_t usage = sizeof (*this) + StealthMemoryMonitor::GetHeapSize (m_interests);
+  for (std::vector<std::string>::const_iterator i = m_interests.begin (); i != m_interests.end (); i++)
+    {
+      usage += StealthMemoryMonitor::GetHeapSize (*i);
+    }
+  return usage;
+}
+
+bool
+StealthInterestSet::HasInterest (std::string interest) const
+{
+  uint8_t bit;
+  if (StealthHeader::FindInterestBit (interest, bit))
+    {
+      return (m_bitset & ((uint64_t) 1 << bit)) != 0;
+    }
+  return std::binary_search (m_interests.end () - m_nExtra, m_interests.end (), interest);
+}
+
+} // namespace ns3
@@ -0,0 +1,119 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * STEALTH Project (2019)
+ */
+
+#ifndef STEALTH_INTEREST_SET_H
+#define STEALTH_INTEREST_SET_H
+
+#include <vector>
+#include <string>
+
+#include "ns3/ptr.h"
+#include "ns3/simple-ref-count.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup network
+ *
+ * \brief Immutable, interned list of interests.
+ *
+ * Nodes of a scenario mostly share a few identical interest lists. Lists
+ * are hash-consed in a pool keyed by their interest bitset: Get returns
+ * the canonical instance of a set of interests, whatever the order or
+ * form it is given in, so every neighbor entry with the same interests
+ * points to the same object and two sets are equal if and only if their
+ * pointers are equal. Names are kept by increasing bit index. An instance
+ * leaves the pool when its last reference is released.
+ *
+ * Only StealthHeader::MAX_INTERESTS distinct interests get a bit. The
+ * interests past them are kept by name, as extra interests, in sets
+ * pooled by bitset and extra names: such sets work as the others, but
+ * cannot be advertised in a StealthHeader.
+ */
+class StealthInterestSet : public SimpleRefCount<StealthInterestSet>
+{
+public:
+  /**
+   * \param interests a list of interest names
+   * \returns the canonical set holding those interests. The interests
+   *          left without a bit are extra interests.
+   */
+  static Ptr<const StealthInterestSet> Get (const std::vector<std::string> &interests);
+  /**
+   * \param bitset an interest bitset, see StealthHeader::GetInterestBitset
+   * \returns the canonical set holding the interests of the bitset,
+   *          by increasing bit index. No allocation takes place when
+   *          the set is already in the pool.
+   */
+  static Ptr<const StealthInterestSet> Get (uint64_t bitset);
+  /**
+   * \returns the number of distinct sets alive in the pool
+   */
+  static uint32_t GetNSets (void);
+  /**
+   * \returns the number of distinct sets with extra interests alive in
+   *          the pool
+   */
+  static uint32_t GetNExtraSets (void);
+  /**
+   * \returns the bytes used by the sets alive in the pool and by the
+   *          pool index, heap capacity included
+   */
+  static uint64_t GetPoolMemoryUsage (void);
+
+  ~StealthInterestSet ();
+
+  /**
+   * \returns the interest names, by increasing bit index, then the
+   *          extra interests, in lexicographic order
+   */
+  const std::vector<std::string> &GetInterests (void) const;
+  /**
+   * \returns the bitset of the interests with a bit
+   */
+  uint64_t GetBitset (void) const;
+  /**
+   * \returns true if the set has interests without a bit, which the
+   *          bitset does not hold
+   */
+  bool HasExtraInterests (void) const;
+  /**
+   * \param interest an interest name
+   * \returns true if the set holds that interest
+   */
+  bool HasInterest (std::string interest) const;
+  /**
+   * \returns the bytes used by the set, heap capacity included
+   */
+  uint64_t GetMemoryUsage (void) const;
+
+private:
+  /**
+   * \param bitset the interest bitset
+   * \param extra the interests without a bit, sorted and unique
+   */
+  StealthInterestSet (uint64_t bitset, const std::vector<std::string> &extra);
+
+  std::vector<std::string> m_interests;  //!< interest names, by increasing bit index, then the extra ones
+  uint64_t m_bitset;                     //!< interest bitset
+  uint32_t m_nExtra;                     //!< number of extra interests, at the end of m_interests
+};
+
+} // namespace ns3
+
+#endif /* STEALTH_INTEREST_SET_H */
@@ -0,0 +1,91 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * STEALTH Project (2019)
+ */
+
+#include <cinttypes>
+
+#include "stealth-memory-monitor.h"
+#include "stealth-interest-set.h"
+#include "node.h"
+#include "node-list.h"
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/simulator.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("StealthMemoryMonitor");
+
+std::FILE *StealthMemoryMonitor::m_file = 0;
+Time StealthMemoryMonitor::m_interval;
+EventId StealthMemoryMonitor::m_event;
+
+void
+StealthMemoryMonitor::Start (std::string fileName, Time interval)
+{
+  NS_LOG_FUNCTION (fileName << interval);
+  NS_ABORT_MSG_IF (interval <= Seconds (0.0), "Monitor interval must be positive");
+  Stop ();
+  m_file = std::fopen (fileName.c_str (), "w");
+  NS_ABORT_MSG_IF (m_file == 0, "Cannot create memory monitor file " << fileName);
+  std::fprintf (m_file, "# time nodes neighborEntries neighbors attendings competences "
+                "duplicateCaches trustReports interestPool total\n");
+  m_interval = interval;
+  m_event = Simulator::ScheduleNow (&StealthMemoryMonitor::Sample);
+  Simulator::ScheduleDestroy (&StealthMemoryMonitor::Stop);
+}
+
+void
+StealthMemoryMonitor::Stop (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  Simulator::Cancel (m_event);
+  if (m_file != 0)
+    {
+      std::fclose (m_file);
+      m_file = 0;
+    }
+}
+
+void
+StealthMemoryMonitor::Sample (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  Node::StealthMemoryUsage sum;
+  uint64_t nodes = 0;
+  for (NodeList::Iterator i = NodeList::Begin (); i != NodeList::End (); i++)
+    {
+      Node::StealthMemoryUsage usage = (*i)->GetStealthMemoryUsage ();
+      sum.neighborEntries += usage.neighborEntries;
+      sum.neighbors += usage.neighbors;
+      sum.attendings += usage.attendings;
+      sum.competence += usage.competence;
+      sum.duplicateCache += usage.duplicateCache;
+      sum.trustReports += usage.trustReports;
+      nodes++;
+    }
+  uint64_t pool = StealthInterestSet::GetPoolMemoryUsage ();
+  uint64_t total = sum.GetTotal () + pool;
+  std::fprintf (m_file, "%.9f %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64
+                " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 "\n",
+                Simulator::Now ().GetSeconds (), nodes, sum.neighborEntries, sum.neighbors,
+                sum.attendings, sum.competence, sum.duplicateCache, sum.trustReports, pool, total);
+  std::fflush (m_file);
+  m_event = Simulator::Schedule (m_interval, &StealthMemoryMonitor::Sample);
+}
+
+} // namespace ns3
@@ -0,0 +1,97 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * STEALTH Project (2019)
+ */
+
+#ifndef STEALTH_MEMORY_MONITOR_H
+#define STEALTH_MEMORY_MONITOR_H
+
+#include <string>
+#include <vector>
+#include <cstdio>
+
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup network
+ *
+ * \brief Periodic summary of the memory used by the Stealth state of
+ * all nodes.
+ *
+ * At every interval, one line is written to the monitor file with the
+ * simulation time, the number of nodes, the number of neighbor entries
+ * and the bytes used by neighbor lists, attending lists, node competences,
+ * duplicate caches and the shared interest pool, as reported by
+ * Node::GetStealthMemoryUsage and StealthInterestSet::GetPoolMemoryUsage.
+ * Byte counts include the heap capacity of vectors and strings.
+ */
+class StealthMemoryMonitor
+{
+public:
+  /**
+   * \param fileName the monitor file, truncated
+   * \param interval the sampling interval
+   *
+   * Sample now and then at every interval, until Stop or the end of
+   * the simulation.
+   */
+  static void Start (std::string fileName, Time interval);
+  /**
+   * \brief Stop sampling and close the monitor file.
+   */
+  static void Stop (void);
+
+  /**
+   * \param s a string
+   * \returns the bytes allocated on the heap by the string, 0 if it is
+   *          stored inline
+   */
+  static uint64_t GetHeapSize (const std::string &s)
+  {
+    const char *object = reinterpret_cast<const char *> (&s);
+    if (s.data () >= object && s.data () < object + sizeof (s))
+      {
+        return 0;
+      }
+    return s.capacity () + 1;
+  }
+  /**
+   * \param v a vector
+   * \returns the bytes allocated on the heap by the vector itself
+   */
+  template <typename T>
+  static uint64_t GetHeapSize (const std::vector<T> &v)
+  {
+    return v.capacity () * sizeof (T);
+  }
+
+private:
+  /**
+   * \brief Write the summary of every node and schedule the next sample.
+   */
+  static void Sample (void);
+
+  static std::FILE *m_file;     //!< monitor file, 0 if not sampling
+  static Time m_interval;       //!< sampling interval
+  static EventId m_event;       //!< next sample
+};
+
+} // namespace ns3
+
+#endif /* STEALTH_MEMORY_MONITOR_H */
@@ -0,0 +1,301 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * STEALTH Project (2019)
+ */
+
+#include <cmath>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+#include "stealth-metrics.h"
+#include "node.h"
+#include "node-list.h"
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/simulator.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("StealthMetrics");
+
+namespace {
+
+/// Order of centroids by mean
+struct ByMean
+{
+  template <typename C>
+  bool operator() (const C &a, const C &b) const
+  {
+    return a.mean < b.mean;
+  }
+};
+
+} // anonymous namespace
+
+StealthQuantileEstimator::StealthQuantileEstimator (double compression)
+  : m_compression (compression),
+    m_count (0),
+    m_sum (0),
+    m_min (0),
+    m_max (0)
+{
+}
+
+void
+StealthQuantileEstimator::Add (double value)
+{
+  m_min = m_count == 0 ? value : std::min (m_min, value);
+  m_max = m_count == 0 ? value : std::max (m_max, value);
+  m_count++;
+  m_sum += value;
+  Centroid centroid;
+  centroid.mean = value;
+  centroid.weight = 1;
+  m_buffer.push_back (centroid);
+  if (m_buffer.size () >= 5 * m_compression)
+    {
+      Merge ();
+    }
+}
+
+uint64_t
+StealthQuantileEstimator::GetCount (void) const
+{
+  return m_count;
+}
+
+double
+StealthQuantileEstimator::GetMean (void) const
+{
+  return m_count == 0 ? 0 : m_sum / m_count;
+}
+
+double
+StealthQuantileEstimator::GetMin (void) const
+{
+  return m_min;
+}
+
+double
+StealthQuantileEstimator::GetMax (void) const
+{
+  return m_max;
+}
+
+double
+StealthQuantileEstimator::Scale (double q) const
+{
+  return m_compression / (2 * M_PI) * std::asin (2 * q - 1);
+}
+
+void
+StealthQuantileEstimator::Merge (void) const
+{
+  if (m_buffer.empty ())
+    {
+      return;
+    }
+  m_buffer.insert (m_buffer.end (), m_centroids.begin (), m_centroids.end ());
+  std::sort (m_buffer.begin (), m_buffer.end (), ByMean ());
+  double total = 0;
+  for (std::vector<Centroid>::const_iterator i = m_buffer.begin (); i != m_buffer.end (); i++)
+    {
+      total += i->weight;
+    }
+
+  // a centroid grows while it spans less than one unit of the scale function
+  m_centroids.clear ();
+  Centroid current = m_buffer[0];
+  double before = 0;
+  double low = Scale (0);
+  for (uint32_t i = 1; i < m_buffer.size (); i++)
+    {
+      const Centroid &next = m_buffer[i];
+      if (Scale ((before + current.weight + next.weight) / total) - low <= 1)
+        {
+          current.mean += (next.mean - current.mean) * next.weight / (current.weight + next.weight);
+          current.weight += next.weight;
+        }
+      else
+        {
+          m_centroids.push_back (current);
+          before += current.weight;
+          low = Scale (before / total);
+          current = next;
+        }
+    }
+  m_centroids.push_back (current);
+  m_buffer.clear ();
+}
+
+double
+StealthQuantileEstimator::GetQuantile (double q) const
+{
+  if (m_count == 0)
+    {
+      return 0;
+    }
+  Merge ();
+  if (m_centroids.size () == 1)
+    {
+      return m_centroids[0].mean;
+    }
+  double target = std::min (std::max (q, 0.0), 1.0) * m_count;
+
+  // interpolate between centroid centers, and toward min and max at the ends
+  double before = 0;
+  for (uint32_t i = 0; i < m_centroids.size (); i++)
+    {
+      const Centroid &c = m_centroids[i];
+      double center = before + c.weight / 2;
+      if (target < center)
+        {
+          if (i == 0)
+            {
+              return m_min + (c.mean - m_min) * target / center;
+            }
+          const Centroid &p = m_centroids[i - 1];
+          double previous = before - p.weight / 2;
+          return p.mean + (c.mean - p.mean) * (target - previous) / (center - previous);
+        }
+      before += c.weight;
+    }
+  const Centroid &last = m_centroids.back ();
+  double center = m_count - last.weight / 2;
+  return last.mean + (m_max - last.mean) * (target - center) / (m_count - center);
+}
+
+bool StealthMetrics::m_enabled = false;
+std::string StealthMetrics::m_fileName;
+std::map<uint32_t, StealthMetrics::Emergency> StealthMetrics::m_emergencies;
+uint64_t StealthMetrics::m_nEmergencies = 0;
+uint64_t StealthMetrics::m_nServed = 0;
+StealthQuantileEstimator StealthMetrics::m_responseTime;
+StealthQuantileEstimator StealthMetrics::m_queueDepth;
+StealthQuantileEstimator StealthMetrics::m_serviceTime;
+
+void
+StealthMetrics::Enable (std::string fileName)
+{
+  NS_LOG_FUNCTION (fileName);
+  m_enabled = true;
+  m_fileName = fileName;
+  m_emergencies.clear ();
+  m_nEmergencies = 0;
+  m_nServed = 0;
+  m_responseTime = StealthQuantileEstimator ();
+  m_queueDepth = StealthQuantileEstimator ();
+  m_serviceTime = StealthQuantileEstimator ();
+  Simulator::ScheduleNow (&StealthMetrics::Scan);
+  Simulator::ScheduleDestroy (&StealthMetrics::Report);
+}
+
+void
+StealthMetrics::Scan (void)
+{
+  for (NodeList::Iterator i = NodeList::Begin (); i != NodeList::End (); i++)
+    {
+      if ((*i)->GetStatus ())
+        {
+          NotifyStatus ((*i)->GetId (), false, true);
+        }
+    }
+}
+
+void
+StealthMetrics::NotifyStatus (uint32_t node, bool from, bool to)
+{
+  if (to && m_emergencies.find (node) == m_emergencies.end ())
+    {
+      Emergency emergency;
+      emergency.start = Simulator::Now ().GetSeconds ();
+      emergency.served = false;
+      m_emergencies[node] = emergency;
+      m_nEmergencies++;
+    }
+  else if (from && !to)
+    {
+      m_emergencies.erase (node);
+    }
+}
+
+void
+StealthMetrics::NotifyAttendingCall (uint32_t origin, uint32_t depth)
+{
+  m_queueDepth.Add (depth);
+  std::map<uint32_t, Emergency>::iterator i = m_emergencies.find (origin);
+  if (i != m_emergencies.end () && !i->second.served)
+    {
+      i->second.served = true;
+      m_nServed++;
+      m_responseTime.Add (Simulator::Now ().GetSeconds () - i->second.start);
+    }
+}
+
+void
+StealthMetrics::NotifyAttendingClosed (double callTime, uint32_t depth)
+{
+  m_queueDepth.Add (depth);
+  m_serviceTime.Add (Simulator::Now ().GetSeconds () - callTime);
+}
+
+void
+StealthMetrics::PrintSeries (std::ostream &os, std::string name, const StealthQuantileEstimator &series)
+{
+  os << name << ": count=" << series.GetCount ()
+     << " mean=" << series.GetMean ()
+     << " min=" << series.GetMin ()
+     << " p50=" << series.GetQuantile (0.5)
+     << " p90=" << series.GetQuantile (0.9)
+     << " p99=" << series.GetQuantile (0.99)
+     << " max=" << series.GetMax () << std::endl;
+}
+
+void
+StealthMetrics::Print (std::ostream &os)
+{
+  os << "emergencies: " << m_nEmergencies
+     << " served=" << m_nServed
+     << " coverage=" << (m_nEmergencies == 0 ? 0.0 : (double) m_nServed / m_nEmergencies)
+     << std::endl;
+  PrintSeries (os, "timeToFirstResponder", m_responseTime);
+  PrintSeries (os, "attendingQueueDepth", m_queueDepth);
+  PrintSeries (os, "attendingServiceTime", m_serviceTime);
+}
+
+void
+StealthMetrics::Report (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  if (!m_enabled)
+    {
+      return;
+    }
+  if (m_fileName.empty ())
+    {
+      Print (std::cout);
+    }
+  else
+    {
+      std::ofstream os (m_fileName.c_str ());
+      NS_ABORT_MSG_IF (!os, "Cannot create metrics file " << m_fileName);
+      Print (os);
+    }
+  m_enabled = false;
+}
+
+} // namespace ns3
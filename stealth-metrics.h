@@ -0,0 +1,196 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * STEALTH Project (2019)
+ */
+
+#ifndef STEALTH_METRICS_H
+#define STEALTH_METRICS_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <ostream>
+
+namespace ns3 {
+
+/**
+ * \ingroup network
+ *
+ * \brief Streaming estimator of the mean and quantiles of a series.
+ *
+ * A merging t-digest: values are buffered, then merged into a bounded
+ * number of weighted centroids, small near the tails and larger around
+ * the median. Memory is O(compression) whatever the number of values and
+ * extreme quantiles stay accurate. The count, mean, minimum and maximum
+ * are exact.
+ */
+class StealthQuantileEstimator
+{
+public:
+  /**
+   * \param compression the accuracy parameter: about compression / 2
+   *        centroids are kept
+   */
+  StealthQuantileEstimator (double compression = 100.0);
+
+  /**
+   * \param value a value of the series
+   */
+  void Add (double value);
+
+  /**
+   * \returns the number of values
+   */
+  uint64_t GetCount (void) const;
+  /**
+   * \returns the mean of the values, 0 if none
+   */
+  double GetMean (void) const;
+  /**
+   * \returns the smallest value, 0 if none
+   */
+  double GetMin (void) const;
+  /**
+   * \returns the biggest value, 0 if none
+   */
+  double GetMax (void) const;
+  /**
+   * \param q a quantile, in [0,1]
+   * \returns the estimated value of the quantile, 0 if no value
+   */
+  double GetQuantile (double q) const;
+
+private:
+  /// A weighted centroid
+  struct Centroid
+  {
+    double mean;     //!< mean of the merged values
+    double weight;   //!< number of merged values
+  };
+
+  /**
+   * \brief Merge the buffered values into the centroids.
+   */
+  void Merge (void) const;
+  /**
+   * \param q a quantile
+   * \returns the t-digest scale function at q
+   */
+  double Scale (double q) const;
+
+  double m_compression;                        //!< accuracy parameter
+  mutable std::vector<Centroid> m_centroids;   //!< merged centroids, by mean
+  mutable std::vector<Centroid> m_buffer;      //!< values not yet merged
+  uint64_t m_count;                            //!< number of values
+  double m_sum;                                //!< sum of the values
+  double m_min;                                //!< smallest value
+  double m_max;                                //!< biggest value
+};
+
+/**
+ * \ingroup network
+ *
+ * \brief In-simulation service metrics, reported at the end of the run.
+ *
+ * Once enabled, Node reports its status changes and attending list
+ * updates, from which are estimated, without any log:
+ * - the fraction of emergencies that got at least one responder,
+ * - the time from an emergency to its first responder (attendings
+ *   registered from a StealthHeader, identified by their origin, or
+ *   from the address of a neighbor known from its hellos),
+ * - the attending queue depth of responders at each update,
+ * - the time from an attending call to its closing.
+ *
+ * The summary is written when the simulator is destroyed.
+ */
+class StealthMetrics
+{
+public:
+  /**
+   * \param fileName the summary file, or "" for the standard output
+   *
+   * Start collecting. Nodes already in Emergency status are counted
+   * as emergencies starting now.
+   */
+  static void Enable (std::string fileName);
+  /**
+   * \returns true while collecting
+   */
+  static bool IsEnabled (void)
+  {
+    return m_enabled;
+  }
+
+  /**
+   * \param node the node id
+   * \param from the previous status
+   * \param to the new status
+   */
+  static void NotifyStatus (uint32_t node, bool from, bool to);
+  /**
+   * \param origin the node id of the emergency origin, or NO_ORIGIN
+   * \param depth the attending queue depth after the call
+   */
+  static void NotifyAttendingCall (uint32_t origin, uint32_t depth);
+  /**
+   * \param callTime the time of the attending call, in seconds
+   * \param depth the attending queue depth after the closing
+   */
+  static void NotifyAttendingClosed (double callTime, uint32_t depth);
+
+  /**
+   * \param os receives the summary
+   */
+  static void Print (std::ostream &os);
+
+  static const uint32_t NO_ORIGIN = 0xffffffff; //!< attending of unknown origin
+
+private:
+  /// An emergency in progress
+  struct Emergency
+  {
+    double start;   //!< start time, in seconds
+    bool served;    //!< a responder registered the emergency
+  };
+
+  /**
+   * \brief Count the nodes already in Emergency status.
+   */
+  static void Scan (void);
+  /**
+   * \brief Write the summary and stop collecting.
+   */
+  static void Report (void);
+  /**
+   * \param os the output stream
+   * \param name the series name
+   * \param series the series
+   */
+  static void PrintSeries (std::ostream &os, std::string name, const StealthQuantileEstimator &series);
+
+  static bool m_enabled;                               //!< collecting
+  static std::string m_fileName;                       //!< summary file
+  static std::map<uint32_t, Emergency> m_emergencies;  //!< emergencies in progress, by node
+  static uint64_t m_nEmergencies;                      //!< emergencies started
+  static uint64_t m_nServed;                           //!< emergencies with a responder
+  static StealthQuantileEstimator m_responseTime;      //!< time to first responder
+  static StealthQuantileEstimator m_queueDepth;        //!< attending queue depths
+  static StealthQuantileEstimator m_serviceTime;       //!< attending call durations
+};
+
+} // namespace ns3
+
+#endif /* STEALTH_METRICS_H */
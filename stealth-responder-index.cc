@@ -0,0 +1,307 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * STEALTH Project (2019)
+ */
+
+#include <cmath>
+#include <algorithm>
+
+#include "stealth-responder-index.h"
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/callback.h"
+#include "ns3/simulator.h"
+#include "ns3/stealth-header.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("StealthResponderIndex");
+
+namespace {
+
+/// A responder candidate and its ranking score
+struct Candidate
+{
+  double score;       //!< distance minus trust weight times trust
+  double trust;       //!< trust of the victim in the candidate
+  double distance;    //!< distance to the victim
+  uint32_t slot;      //!< entry index
+
+  /// Lowest score first, then the most trusted, then the first indexed
+  bool operator< (const Candidate &other) const
+  {
+    if (score != other.score)
+      {
+        return score < other.score;
+      }
+    if (trust != other.trust)
+      {
+        return trust > other.trust;
+      }
+    return slot < other.slot;
+  }
+};
+
+} // anonymous namespace
+
+StealthResponderIndex::StealthResponderIndex (std::vector<Ptr<Node> >::const_iterator begin,
+                                              std::vector<Ptr<Node> >::const_iterator end,
+                                              double cellSize)
+  : m_cellSize (cellSize),
+    m_slack (cellSize / 2),
+    m_trustWeight (0),
+    m_nUpdates (0)
+{
+  NS_LOG_FUNCTION (this << cellSize);
+  NS_ASSERT_MSG (cellSize > 0, "Cell size must be positive");
+  for (std::vector<Ptr<Node> >::const_iterator i = begin; i != end; i++)
+    {
+      Ptr<MobilityModel> mobility = (*i)->GetObject<MobilityModel> ();
+      if (mobility == 0)
+        {
+          continue;
+        }
+      Entry entry;
+      entry.node = *i;
+      entry.mobility = mobility;
+      entry.competence = 0;
+      entry.indexed = false;
+      entry.cell = 0;
+      entry.version = 0;
+      uint32_t slot = m_entries.size ();
+      m_entries.push_back (entry);
+      m_slots[(*i)->GetId ()] = slot;
+      mobility->TraceConnectWithoutContext ("CourseChange",
+                                            MakeBoundCallback (&StealthResponderIndex::CourseChanged,
+                                                               this, slot));
+      Place (slot);
+    }
+}
+
+StealthResponderIndex::~StealthResponderIndex ()
+{
+  NS_LOG_FUNCTION (this);
+  for (uint32_t slot = 0; slot < m_entries.size (); slot++)
+    {
+      m_entries[slot].mobility->TraceDisconnectWithoutContext ("CourseChange",
+                                                                MakeBoundCallback (&StealthResponderIndex::CourseChanged,
+                                                                                   this, slot));
+    }
+}
+
+void
+StealthResponderIndex::SetTrustWeight (double trustWeight)
+{
+  m_trustWeight = trustWeight;
+}
+
+void
+StealthResponderIndex::Update (Ptr<Node> node)
+{
+  NS_LOG_FUNCTION (this << node);
+  std::map<uint32_t, uint32_t>::const_iterator i = m_slots.find (node->GetId ());
+  NS_ASSERT_MSG (i != m_slots.end (), "Node " << node->GetId () << " is not indexed");
+  Place (i->second);
+}
+
+uint64_t
+StealthResponderIndex::GetNUpdates (void) const
+{
+  return m_nUpdates;
+}
+
+void
+StealthResponderIndex::CourseChanged (StealthResponderIndex *index, uint32_t slot,
+                                      Ptr<const MobilityModel> /* mobility */)
+{
+  index->Place (slot);
+}
+
+uint64_t
+StealthResponderIndex::GetCell (const Vector &position) const
+{
+  int32_t cx = static_cast<int32_t> (std::floor (position.x / m_cellSize));
+  int32_t cy = static_cast<int32_t> (std::floor (position.y / m_cellSize));
+  return ((uint64_t) (uint32_t) cx << 32) | (uint32_t) cy;
+}
+
+void
+StealthResponderIndex::Remove (std::vector<uint32_t> &cell, uint32_t slot)
+{
+  std::vector<uint32_t>::iterator i = std::find (cell.begin (), cell.end (), slot);
+  NS_ASSERT (i != cell.end ());
+  *i = cell.back ();
+  cell.pop_back ();
+}
+
+void
+StealthResponderIndex::Place (uint32_t slot)
+{
+  Entry &entry = m_entries[slot];
+  Vector position = entry.mobility->GetPosition ();
+  uint8_t competence = StealthHeader::GetCompetenceId (entry.node->GetCompetence ());
+  uint64_t cell = GetCell (position);
+  m_nUpdates++;
+
+  if (!entry.indexed || entry.competence != competence || entry.cell != cell)
+    {
+      if (entry.indexed)
+        {
+          Grid &grid = m_grids[entry.competence];
+          Grid::iterator i = grid.find (entry.cell);
+          Remove (i->second, slot);
+          if (i->second.empty ())
+            {
+              grid.erase (i);
+            }
+        }
+      if (competence >= m_grids.size ())
+        {
+          m_grids.resize (competence + 1);
+        }
+      m_grids[competence][cell].push_back (slot);
+      entry.competence = competence;
+      entry.cell = cell;
+      entry.indexed = true;
+    }
+
+  // deadlines computed before this placement are stale
+  entry.version++;
+  double speed = CalculateDistance (entry.mobility->GetVelocity (), Vector (0, 0, 0));
+  if (speed > 0)
+    {
+      Due due;
+      due.at = Simulator::Now ().GetSeconds () + m_slack / speed;
+      due.slot = slot;
+      due.version = entry.version;
+      m_due.push (due);
+    }
+}
+
+void
+StealthResponderIndex::Refresh (void)
+{
+  double now = Simulator::Now ().GetSeconds ();
+  while (!m_due.empty () && m_due.top ().at <= now)
+    {
+      Due due = m_due.top ();
+      m_due.pop ();
+      if (due.version == m_entries[due.slot].version)
+        {
+          Place (due.slot);
+        }
+    }
+}
+
+uint32_t
+StealthResponderIndex::GetNearest (Ptr<Node> victim, std::string competence, double radius,
+                                   uint32_t k, std::vector<Responder> &responders)
+{
+  NS_LOG_FUNCTION (this << victim << competence << radius << k);
+  responders.clear ();
+  Ptr<MobilityModel> mobility = victim->GetObject<MobilityModel> ();
+  NS_ASSERT_MSG (mobility != 0, "Victim " << victim->GetId () << " has no mobility model");
+  // a competence no node ever had has no responder
+  uint8_t id;
+  if (!StealthHeader::FindCompetenceId (competence, id) || id >= m_grids.size () || k == 0)
+    {
+      return 0;
+    }
+  Refresh ();
+
+  // nodes are at most m_slack away from the cell they are placed in
+  const Grid &grid = m_grids[id];
+  Vector position = mobility->GetPosition ();
+  double reach = radius + m_slack;
+  int32_t x0 = static_cast<int32_t> (std::floor ((position.x - reach) / m_cellSize));
+  int32_t x1 = static_cast<int32_t> (std::floor ((position.x + reach) / m_cellSize));
+  int32_t y0 = static_cast<int32_t> (std::floor ((position.y - reach) / m_cellSize));
+  int32_t y1 = static_cast<int32_t> (std::floor ((position.y + reach) / m_cellSize));
+  std::vector<const std::vector<uint32_t> *> cells;
+  if ((double) (x1 - x0 + 1) * (y1 - y0 + 1) > grid.size ())
+    {
+      // a wide radius: the occupied cells are fewer than the covered ones
+      for (Grid::const_iterator i = grid.begin (); i != grid.end (); i++)
+        {
+          cells.push_back (&i->second);
+        }
+    }
+  else
+    {
+      for (int32_t cx = x0; cx <= x1; cx++)
+        {
+          for (int32_t cy = y0; cy <= y1; cy++)
+            {
+              Grid::const_iterator i = grid.find (((uint64_t) (uint32_t) cx << 32) | (uint32_t) cy);
+              if (i != grid.end ())
+                {
+                  cells.push_back (&i->second);
+                }
+            }
+        }
+    }
+
+  // without a trust weight, the trust is only looked up for the
+  // responders found
+  std::map<uint32_t, double> trusts;
+  if (m_trustWeight != 0)
+    {
+      trusts = victim->GetNeighborNodeTrusts ();
+    }
+  std::vector<Candidate> candidates;
+  for (uint32_t c = 0; c < cells.size (); c++)
+    {
+      for (std::vector<uint32_t>::const_iterator s = cells[c]->begin (); s != cells[c]->end (); s++)
+        {
+          const Entry &entry = m_entries[*s];
+          if (entry.node == victim || entry.node->GetStatus () || !entry.node->IsActive ())
+            {
+              continue;
+            }
+          double distance = CalculateDistance (entry.mobility->GetPosition (), position);
+          if (distance > radius)
+            {
+              continue;
+            }
+          Candidate candidate;
+          std::map<uint32_t, double>::const_iterator trust = trusts.find (entry.node->GetId ());
+          candidate.trust = trust == trusts.end () ? 0.0 : trust->second;
+          candidate.distance = distance;
+          candidate.score = distance - m_trustWeight * candidate.trust;
+          candidate.slot = *s;
+          candidates.push_back (candidate);
+        }
+    }
+
+  uint32_t count = std::min<uint32_t> (k, candidates.size ());
+  std::partial_sort (candidates.begin (), candidates.begin () + count, candidates.end ());
+  for (uint32_t i = 0; i < count; i++)
+    {
+      Responder responder;
+      responder.node = m_entries[candidates[i].slot].node;
+      responder.distance = candidates[i].distance;
+      responder.trust = candidates[i].trust;
+      if (m_trustWeight == 0)
+        {
+          Node::NeighborHandle neighbor = victim->FindNeighborNode (responder.node->GetId ());
+          responder.trust = neighbor.IsEmpty () ? 0.0 : neighbor.GetTrust ();
+        }
+      responders.push_back (responder);
+    }
+  return count;
+}
+
+} // namespace ns3
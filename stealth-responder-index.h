@@ -0,0 +1,188 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * STEALTH Project (2019)
+ */
+
+#ifndef STEALTH_RESPONDER_INDEX_H
+#define STEALTH_RESPONDER_INDEX_H
+
+#include <vector>
+#include <map>
+#include <queue>
+#include <string>
+
+#include "ns3/ptr.h"
+#include "ns3/simple-ref-count.h"
+#include "ns3/vector.h"
+#include "ns3/mobility-model.h"
+#include "ns3/node.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup mobility
+ *
+ * \brief Spatial index of the nodes by competence, to find the responders
+ * nearest to a victim.
+ *
+ * Each competence has its own grid of square cells holding the nodes with
+ * that competence, so that a query only visits the cells around the victim
+ * and only the nodes able to respond. The index follows mobility
+ * incrementally: a node is moved to its new cell on each CourseChange of
+ * its mobility model and, while it walks at constant velocity, when it
+ * may have drifted by more than half a cell since it was last placed. The
+ * drift deadlines wait in a time-ordered queue, so a query only re-places
+ * the nodes that are due.
+ *
+ * The index is connected to the mobility models of the nodes until it
+ * is destroyed.
+ */
+class StealthResponderIndex : public SimpleRefCount<StealthResponderIndex>
+{
+public:
+  /// A responder found by GetNearest
+  struct Responder
+  {
+    Ptr<Node> node;     //!< the responder node
+    double distance;    //!< distance to the victim, in meters
+    double trust;       //!< trust of the victim in the responder, 0 if not a neighbor
+  };
+
+  /**
+   * \param begin first node of the population
+   * \param end past the last node of the population
+   * \param cellSize the grid cell side, in meters, e.g. the usual
+   *        query radius
+   *
+   * Nodes without a mobility model are not indexed.
+   */
+  StealthResponderIndex (std::vector<Ptr<Node> >::const_iterator begin,
+                         std::vector<Ptr<Node> >::const_iterator end,
+                         double cellSize);
+  /**
+   * Disconnect the index from the mobility models of the nodes.
+   */
+  ~StealthResponderIndex ();
+
+  /**
+   * \param trustWeight meters of distance one unit of trust is worth in
+   *        the ranking, 0 (the default) to rank by distance and break
+   *        ties by trust
+   */
+  void SetTrustWeight (double trustWeight);
+
+  /**
+   * \param node an indexed node
+   *
+   * Place the node again in the index, e.g. after a change of its
+   * competence with Node::SetCompetence.
+   */
+  void Update (Ptr<Node> node);
+
+  /**
+   * \param victim the node needing a responder
+   * \param competence the competence of the responders
+   * \param radius the maximum distance to the victim, in meters
+   * \param k the maximum number of responders
+   * \param responders receives the responders within the radius, at
+   *        most k, by increasing distance minus trust weight times trust
+   * \returns the number of responders found
+   *
+   * Responders in Emergency status or dormant and the victim are left out. The trust
+   * of a responder is the victim's trust in it, when it is a neighbor known
+   * from its hellos. Without a trust weight, responders at the same distance
+   * are not ordered by trust. A competence no node ever had has no responder.
+   */
+  uint32_t GetNearest (Ptr<Node> victim, std::string competence, double radius,
+                       uint32_t k, std::vector<Responder> &responders);
+
+  /**
+   * \returns the number of nodes placed again in the index since its
+   *          creation, mobility and Update together
+   */
+  uint64_t GetNUpdates (void) const;
+
+private:
+  /// An indexed node
+  struct Entry
+  {
+    Ptr<Node> node;                 //!< the node
+    Ptr<MobilityModel> mobility;    //!< its mobility model
+    uint8_t competence;             //!< competence id of its grid
+    bool indexed;                   //!< the node is in a grid
+    uint64_t cell;                  //!< grid cell key
+    uint32_t version;               //!< placements of the node, for stale drift deadlines
+  };
+
+  /// A drift deadline
+  struct Due
+  {
+    double at;          //!< time the node may leave its cell neighborhood, in seconds
+    uint32_t slot;      //!< entry index
+    uint32_t version;   //!< entry version when the deadline was computed
+
+    /// Earliest deadline first in a priority queue
+    bool operator< (const Due &other) const
+    {
+      return at > other.at;
+    }
+  };
+
+  /// Nodes of each cell of a grid
+  typedef std::map<uint64_t, std::vector<uint32_t> > Grid;
+
+  /**
+   * \param index the index
+   * \param slot the entry index of the node
+   * \param mobility the mobility model of the node
+   */
+  static void CourseChanged (StealthResponderIndex *index, uint32_t slot,
+                             Ptr<const MobilityModel> mobility);
+  /**
+   * \param slot an entry index
+   *
+   * Move the node to the grid and cell of its current competence and
+   * position, and compute its drift deadline.
+   */
+  void Place (uint32_t slot);
+  /**
+   * \brief Place again the nodes whose drift deadline is past.
+   */
+  void Refresh (void);
+  /**
+   * \param position a position
+   * \returns the key of the grid cell holding the position
+   */
+  uint64_t GetCell (const Vector &position) const;
+  /**
+   * \param cell the entry indices of a cell
+   * \param slot the entry index to remove
+   */
+  static void Remove (std::vector<uint32_t> &cell, uint32_t slot);
+
+  double m_cellSize;                      //!< grid cell side
+  double m_slack;                         //!< drift allowed before placing a node again
+  double m_trustWeight;                   //!< ranking weight of trust, in meters
+  std::vector<Entry> m_entries;           //!< indexed nodes
+  std::map<uint32_t, uint32_t> m_slots;   //!< entry index of each node id
+  std::vector<Grid> m_grids;              //!< grids, by competence id
+  std::priority_queue<Due> m_due;         //!< drift deadlines
+  uint64_t m_nUpdates;                    //!< placements since creation
+};
+
+} // namespace ns3
+
+#endif /* STEALTH_RESPONDER_INDEX_H */
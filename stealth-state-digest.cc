@@ -0,0 +1,133 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * STEALTH Project (2019)
+ */
+
+#include <cinttypes>
+
+#include "stealth-state-digest.h"
+#include "node.h"
+#include "node-list.h"
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/simulator.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("StealthStateDigest");
+
+std::FILE *StealthStateDigest::m_file = 0;
+Time StealthStateDigest::m_interval;
+EventId StealthStateDigest::m_event;
+
+void
+StealthStateDigest::Start (std::string fileName, Time interval)
+{
+  NS_LOG_FUNCTION (fileName << interval);
+  NS_ABORT_MSG_IF (interval <= Seconds (0.0), "Digest interval must be positive");
+  Stop ();
+  m_file = std::fopen (fileName.c_str (), "w");
+  NS_ABORT_MSG_IF (m_file == 0, "Cannot create digest file " << fileName);
+  m_interval = interval;
+  m_event = Simulator::ScheduleNow (&StealthStateDigest::Sample);
+  Simulator::ScheduleDestroy (&StealthStateDigest::Stop);
+}
+
+void
+StealthStateDigest::Stop (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  Simulator::Cancel (m_event);
+  if (m_file != 0)
+    {
+      std::fclose (m_file);
+      m_file = 0;
+    }
+}
+
+void
+StealthStateDigest::Sample (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  double now = Simulator::Now ().GetSeconds ();
+  for (NodeList::Iterator i = NodeList::Begin (); i != NodeList::End (); i++)
+    {
+      std::fprintf (m_file, "%.9f %u %016" PRIx64 "\n", now, (*i)->GetId (),
+                    (*i)->GetStealthDigest ());
+    }
+  m_event = Simulator::Schedule (m_interval, &StealthStateDigest::Sample);
+}
+
+bool
+StealthStateDigest::Compare (std::string baseline, std::string candidate, std::ostream &os)
+{
+  NS_LOG_FUNCTION (baseline << candidate);
+  std::FILE *a = std::fopen (baseline.c_str (), "r");
+  NS_ABORT_MSG_IF (a == 0, "Cannot open digest file " << baseline);
+  std::FILE *b = std::fopen (candidate.c_str (), "r");
+  NS_ABORT_MSG_IF (b == 0, "Cannot open digest file " << candidate);
+
+  bool same = true;
+  uint64_t line = 0;
+  while (same)
+    {
+      double timeA, timeB;
+      uint32_t nodeA, nodeB;
+      uint64_t digestA, digestB;
+      int readA = std::fscanf (a, "%lf %u %" SCNx64, &timeA, &nodeA, &digestA);
+      int readB = std::fscanf (b, "%lf %u %" SCNx64, &timeB, &nodeB, &digestB);
+      line++;
+      if (readA != 3 || readB != 3)
+        {
+          if (readA == 3 || readB == 3)
+            {
+              os << "Line " << line << ": " << (readA == 3 ? candidate : baseline)
+                 << " ends first" << std::endl;
+              same = false;
+            }
+          break;
+        }
+      if (timeA != timeB || nodeA != nodeB)
+        {
+          os << "Line " << line << ": samples differ, time " << timeA << " node " << nodeA
+             << " vs time " << timeB << " node " << nodeB << std::endl;
+          same = false;
+        }
+      else if (digestA != digestB)
+        {
+          os << "Line " << line << ": node " << nodeA << " diverges at time " << timeA
+             << "s" << std::endl;
+          same = false;
+        }
+    }
+  std::fclose (a);
+  std::fclose (b);
+  return same;
+}
+
+uint64_t
+StealthStateDigest::Hash (uint64_t hash, const void *data, uint32_t size)
+{
+  const uint8_t *bytes = static_cast<const uint8_t *> (data);
+  for (uint32_t i = 0; i < size; i++)
+    {
+      hash ^= bytes[i];
+      hash *= 1099511628211ULL;
+    }
+  return hash;
+}
+
+} // namespace ns3
@@ -0,0 +1,90 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * STEALTH Project (2019)
+ */
+
+#ifndef STEALTH_STATE_DIGEST_H
+#define STEALTH_STATE_DIGEST_H
+
+#include <string>
+#include <ostream>
+#include <cstdio>
+
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup network
+ *
+ * \brief Periodic digest of the Stealth state of every node.
+ *
+ * At every interval, one line per node of NodeList is written to the
+ * digest file: the simulation time, the node id and Node::GetStealthDigest.
+ * Two runs of the same scenario behave the same way if and only if their
+ * digest files are equal (up to hash collisions), so an optimized run is
+ * validated against a baseline run by Compare, which reports the first
+ * divergent node, instead of by diffing logs.
+ */
+class StealthStateDigest
+{
+public:
+  static const uint64_t FNV_OFFSET = 14695981039346656037ULL; //!< FNV-1a initial hash
+
+  /**
+   * \param fileName the digest file, truncated
+   * \param interval the sampling interval
+   *
+   * Sample now and then at every interval, until Stop or the end of
+   * the simulation.
+   */
+  static void Start (std::string fileName, Time interval);
+  /**
+   * \brief Stop sampling and close the digest file.
+   */
+  static void Stop (void);
+
+  /**
+   * \param baseline the digest file of the reference run
+   * \param candidate the digest file of the run to validate
+   * \param os receives the first divergence, if any
+   * \returns true if both files hold the same digests
+   */
+  static bool Compare (std::string baseline, std::string candidate, std::ostream &os);
+
+  /**
+   * \param hash the current hash
+   * \param data bytes to add to the hash
+   * \param size the number of bytes
+   * \returns the FNV-1a hash of the bytes, continuing the current hash
+   */
+  static uint64_t Hash (uint64_t hash, const void *data, uint32_t size);
+
+private:
+  /**
+   * \brief Write the digest of every node and schedule the next sample.
+   */
+  static void Sample (void);
+
+  static std::FILE *m_file;     //!< digest file, 0 if not sampling
+  static Time m_interval;       //!< sampling interval
+  static EventId m_event;       //!< next sample
+};
+
+} // namespace ns3
+
+#endif /* STEALTH_STATE_DIGEST_H */
@@ -0,0 +1,174 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * STEALTH Project (2019)
+ */
+
+#include <sstream>
+
+#include "ns3/test.h"
+#include "ns3/node.h"
+#include "ns3/boolean.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/simulator.h"
+#include "ns3/stealth-header.h"
+#include "ns3/stealth-metrics.h"
+
+using namespace ns3;
+
+/**
+ * \ingroup network-test
+ * \ingroup tests
+ *
+ * \brief Trust reports out of [0,1] are clamped by the header.
+ */
+class StealthTrustReportClampTestCase : public TestCase
+{
+public:
+  StealthTrustReportClampTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+StealthTrustReportClampTestCase::StealthTrustReportClampTestCase ()
+  : TestCase ("Clamp the reported trusts to [0,1]")
+{
+}
+
+void
+StealthTrustReportClampTestCase::DoRun (void)
+{
+  StealthHeader header;
+  header.AddTrustReport (1, 3.5);
+  header.AddTrustReport (2, -1.0);
+  header.AddTrustReport (3, 0.25);
+  NS_TEST_ASSERT_MSG_EQ (header.GetNTrustReports (), 3, "Reports out of [0,1] must be kept");
+  NS_TEST_ASSERT_MSG_EQ (header.GetTrustReportTrust (0), 1.0, "Trust above 1 must be clamped to 1");
+  NS_TEST_ASSERT_MSG_EQ (header.GetTrustReportTrust (1), 0.0, "Negative trust must be clamped to 0");
+  NS_TEST_ASSERT_MSG_EQ_TOL (header.GetTrustReportTrust (2), 0.25, 1.0 / 65535, "Trust in [0,1] must be kept");
+}
+
+/**
+ * \ingroup network-test
+ * \ingroup tests
+ *
+ * \brief Hellos of a node with local trusts above 1 report them
+ * scaled into [0,1], most trusted first.
+ */
+class StealthHelloTrustTestCase : public TestCase
+{
+public:
+  StealthHelloTrustTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+StealthHelloTrustTestCase::StealthHelloTrustTestCase ()
+  : TestCase ("Scale the local trusts above 1 in the hellos")
+{
+}
+
+void
+StealthHelloTrustTestCase::DoRun (void)
+{
+  Ptr<Node> node = CreateObject<Node> ();
+  StealthHeader hello;
+  hello.SetMessageType (StealthHeader::HELLO);
+  hello.SetCompetence (StealthHeader::GetCompetenceId ("doctor"));
+  hello.SetOrigin (node->GetId () + 1);
+  node->RegisterNeighbor (Ipv4Address ("10.0.0.2"), hello, 2.5);
+  hello.SetOrigin (node->GetId () + 2);
+  node->RegisterNeighbor (Ipv4Address ("10.0.0.3"), hello, 5.0);
+
+  StealthHeader header;
+  node->FillHelloHeader (header);
+  NS_TEST_ASSERT_MSG_EQ (header.GetNTrustReports (), 2, "Both neighbors must be reported");
+  NS_TEST_ASSERT_MSG_EQ (header.GetTrustReportSubject (0), node->GetId () + 2, "Most trusted neighbor first");
+  NS_TEST_ASSERT_MSG_EQ (header.GetTrustReportTrust (0), 1.0, "Highest trust must be scaled to 1");
+  NS_TEST_ASSERT_MSG_EQ_TOL (header.GetTrustReportTrust (1), 0.5, 1.0 / 65535, "Trusts must keep their ratio");
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup network-test
+ * \ingroup tests
+ *
+ * \brief Attendings registered from an address are matched with the
+ * emergency of the neighbor that sent hellos from it, and only then.
+ */
+class StealthAttendingOriginTestCase : public TestCase
+{
+public:
+  StealthAttendingOriginTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+StealthAttendingOriginTestCase::StealthAttendingOriginTestCase ()
+  : TestCase ("Resolve the origin of attendings from the neighbor table")
+{
+}
+
+void
+StealthAttendingOriginTestCase::DoRun (void)
+{
+  StealthMetrics::Enable (CreateTempDirFilename ("metrics.txt"));
+  Ptr<Node> responder = CreateObject<Node> ();
+  Ptr<Node> victim = CreateObject<Node> ();
+  Ptr<Node> stranger = CreateObject<Node> ();
+  victim->SetAttribute ("Status", BooleanValue (true));
+  stranger->SetStatus (true);
+
+  StealthHeader hello;
+  hello.SetMessageType (StealthHeader::HELLO);
+  hello.SetCompetence (StealthHeader::GetCompetenceId ("other"));
+  hello.SetOrigin (victim->GetId ());
+  responder->RegisterNeighbor (Ipv4Address ("10.0.0.2"), hello, 0.5);
+  // no hello: the node of that neighbor is not known
+  responder->RegisterNeighbor (Ipv4Address ("10.0.0.3"), "other", std::vector<std::string> (), 0.5);
+  responder->RegisterAttendingCall (Ipv4Address ("10.0.0.2"), "data", 1, 0.0);
+  responder->RegisterAttendingCall (Ipv4Address ("10.0.0.3"), "data", 1, 0.0);
+
+  std::ostringstream os;
+  StealthMetrics::Print (os);
+  NS_TEST_ASSERT_MSG_NE (os.str ().find ("emergencies: 2 served=1 "), std::string::npos,
+                         "Only the neighbor known from its hellos must be served: " << os.str ());
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup network-test
+ * \ingroup tests
+ *
+ * \brief Stealth node extensions TestSuite
+ */
+class StealthTestSuite : public TestSuite
+{
+public:
+  StealthTestSuite ();
+};
+
+StealthTestSuite::StealthTestSuite ()
+  : TestSuite ("stealth", UNIT)
+{
+  AddTestCase (new StealthTrustReportClampTestCase, TestCase::QUICK);
+  AddTestCase (new StealthHelloTrustTestCase, TestCase::QUICK);
+  AddTestCase (new StealthAttendingOriginTestCase, TestCase::QUICK);
+}
+
+static StealthTestSuite g_stealthTestSuite; //!< Static variable for test initialization
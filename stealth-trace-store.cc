@@ -0,0 +1,757 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * STEALTH Project (2019)
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "stealth-trace-store.h"
+#include "ns3/constant-velocity-mobility-model.h"
+#include "ns3/application.h"
+#include "ns3/node-list.h"
+#include "ns3/simulator.h"
+#include "ns3/log.h"
+#include "ns3/abort.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("StealthTraceStore");
+
+/// Stores alive in this process, indexed by binary file
+typedef std::map<std::string, StealthTraceStore *> StoreRegistry;
+
+/**
+ * \brief Get the stores alive in this process.
+ * \returns the registry
+ */
+static StoreRegistry &
+GetStoreRegistry (void)
+{
+  static StoreRegistry *registry = new StoreRegistry ();
+  return *registry;
+}
+
+/**
+ * \brief Sort waypoints by time, keeping the trace order of equal times.
+ * \param a a waypoint
+ * \param b another waypoint
+ * \returns true if a starts before b
+ */
+static bool
+WaypointBefore (const StealthTraceStore::Waypoint &a, const StealthTraceStore::Waypoint &b)
+{
+  return a.time < b.time;
+}
+
+/**
+ * \brief Round a value to the precision of a decimated trace, so that
+ * the trace replays exactly the path that was simplified.
+ * \param value a time or coordinate
+ * \returns the value rounded to the microsecond or micrometer
+ */
+static double
+Round (double value)
+{
+  return std::floor (value * 1e6 + 0.5) / 1e6;
+}
+
+/// A point of the path of a node in space-time
+struct Vertex
+{
+  double t;   //!< time, in seconds
+  double x;   //!< x at that time
+  double y;   //!< y at that time
+};
+
+/**
+ * \brief Get the distance between a vertex and the chord of a path
+ * at the same time (synchronized Euclidean distance).
+ * \param v a vertex
+ * \param a the start of the chord
+ * \param b the end of the chord, later than a
+ * \returns the distance between v and the point of the chord at v.t
+ */
+static double
+GetChordDistance (const Vertex &v, const Vertex &a, const Vertex &b)
+{
+  double ratio = (v.t - a.t) / (b.t - a.t);
+  double dx = a.x + (b.x - a.x) * ratio - v.x;
+  double dy = a.y + (b.y - a.y) * ratio - v.y;
+  return std::sqrt (dx * dx + dy * dy);
+}
+
+/**
+ * \brief Simplify a path with Douglas-Peucker in space-time.
+ * \param path the vertices of the path, by increasing time
+ * \param maxError the largest distance allowed between a vertex and the
+ *        chord replacing it
+ * \param keep receives the vertices kept, the first and last ones included
+ * \returns the largest distance between a dropped vertex and its chord
+ */
+static double
+Simplify (const std::vector<Vertex> &path, double maxError, std::vector<bool> &keep)
+{
+  keep.assign (path.size (), false);
+  if (path.empty ())
+    {
+      return 0;
+    }
+  keep.front () = true;
+  keep.back () = true;
+  double error = 0;
+  std::vector<std::pair<uint32_t, uint32_t> > chords;
+  if (path.size () > 2)
+    {
+      chords.push_back (std::make_pair (0, path.size () - 1));
+    }
+  while (!chords.empty ())
+    {
+      uint32_t a = chords.back ().first;
+      uint32_t b = chords.back ().second;
+      chords.pop_back ();
+      uint32_t farthest = a;
+      double distance = 0;
+      for (uint32_t i = a + 1; i < b; i++)
+        {
+          double d = GetChordDistance (path[i], path[a], path[b]);
+          if (d > distance)
+            {
+              distance = d;
+              farthest = i;
+            }
+        }
+      if (distance <= maxError)
+        {
+          error = std::max (error, distance);
+          continue;
+        }
+      keep[farthest] = true;
+      if (farthest - a > 1)
+        {
+          chords.push_back (std::make_pair (a, farthest));
+        }
+      if (b - farthest > 1)
+        {
+          chords.push_back (std::make_pair (farthest, b));
+        }
+    }
+  return error;
+}
+
+Ptr<StealthTraceStore>
+StealthTraceStore::Open (std::string traceFile, double keyframePeriod)
+{
+  NS_LOG_FUNCTION (traceFile << keyframePeriod);
+  std::string binaryFile = traceFile + ".bin";
+  StoreRegistry &registry = GetStoreRegistry ();
+  StoreRegistry::iterator i = registry.find (binaryFile);
+  if (i != registry.end ())
+    {
+      return Ptr<StealthTraceStore> (i->second);
+    }
+
+  struct stat trace;
+  struct stat binary;
+  NS_ABORT_MSG_IF (stat (traceFile.c_str (), &trace) != 0, "Cannot stat trace " << traceFile);
+  if (stat (binaryFile.c_str (), &binary) != 0 || binary.st_mtime < trace.st_mtime
+      || !IsCurrent (binaryFile))
+    {
+      Convert (traceFile, binaryFile, keyframePeriod);
+    }
+  StealthTraceStore *store = new StealthTraceStore (binaryFile);
+  registry[binaryFile] = store;
+  return Ptr<StealthTraceStore> (store, false);
+}
+
+StealthTraceStore::Decimation
+StealthTraceStore::Decimate (std::string traceFile, std::string decimatedFile, double maxError)
+{
+  NS_LOG_FUNCTION (traceFile << decimatedFile << maxError);
+  NS_ABORT_MSG_IF (maxError < 0, "Position error must not be negative");
+  Ptr<StealthTraceStore> store = Open (traceFile);
+  std::ofstream out (decimatedFile.c_str ());
+  NS_ABORT_MSG_UNLESS (out.is_open (), "Cannot write " << decimatedFile);
+  out << std::fixed << std::setprecision (6);
+
+  Decimation decimation;
+  decimation.nWaypoints = 0;
+  decimation.nDecimated = 0;
+  decimation.maxError = 0;
+  std::vector<Vertex> path;
+  std::vector<bool> keep;
+  for (uint32_t n = 0; n < store->GetNNodes (); n++)
+    {
+      Vector initial = store->GetInitialPosition (n);
+      out << "$node_(" << n << ") set X_ " << initial.x << std::endl;
+      out << "$node_(" << n << ") set Y_ " << initial.y << std::endl;
+      if (initial.z != 0)
+        {
+          out << "$node_(" << n << ") set Z_ " << initial.z << std::endl;
+        }
+
+      // the path bends only at waypoints and arrivals, and is straight in between
+      const Waypoint *w = store->GetWaypoints (n);
+      uint32_t count = store->GetNWaypoints (n);
+      decimation.nWaypoints += count;
+      Motion motion;
+      std::memset (&motion, 0, sizeof (motion));
+      motion.x = initial.x;
+      motion.y = initial.y;
+      path.clear ();
+      for (uint32_t i = 0; i < count; i++)
+        {
+          Advance (motion, w, i + 1, w[i].time);
+          Vertex v = { Round (w[i].time), Round (motion.x), Round (motion.y) };
+          if (!path.empty () && path.back ().t >= v.t)
+            {
+              path.back () = v;
+            }
+          else
+            {
+              path.push_back (v);
+            }
+          if (motion.moving)
+            {
+              double dx = motion.dx - motion.x;
+              double dy = motion.dy - motion.y;
+              Vertex arrival = { Round (w[i].time + std::sqrt (dx * dx + dy * dy) / motion.speed),
+                                 Round (motion.dx), Round (motion.dy) };
+              if (arrival.t > v.t && (i + 1 == count || arrival.t < w[i + 1].time))
+                {
+                  path.push_back (arrival);
+                }
+            }
+        }
+      if (path.empty ())
+        {
+          continue;
+        }
+
+      decimation.maxError = std::max (decimation.maxError, Simplify (path, maxError, keep));
+      if (path.size () == 1)
+        {
+          // a node that never moves still appears at its waypoint
+          out << "$ns_ at " << path[0].t << " \"$node_(" << n << ") setdest "
+              << path[0].x << " " << path[0].y << " 0.000000\"" << std::endl;
+          decimation.nDecimated++;
+          continue;
+        }
+      uint32_t a = 0;
+      bool still = false;
+      for (uint32_t b = 1; b < path.size (); b++)
+        {
+          if (!keep[b])
+            {
+              continue;
+            }
+          double dx = path[b].x - path[a].x;
+          double dy = path[b].y - path[a].y;
+          out << "$ns_ at " << path[a].t << " \"$node_(" << n << ") setdest "
+              << path[b].x << " " << path[b].y << " "
+              << std::sqrt (dx * dx + dy * dy) / (path[b].t - path[a].t) << "\"" << std::endl;
+          decimation.nDecimated++;
+          still = dx == 0 && dy == 0;
+          a = b;
+        }
+      if (still)
+        {
+          // a node standing still at the end leaves when the trace says so
+          out << "$ns_ at " << path[a].t << " \"$node_(" << n << ") setdest "
+              << path[a].x << " " << path[a].y << " 0.000000\"" << std::endl;
+          decimation.nDecimated++;
+        }
+    }
+  out.close ();
+  NS_ABORT_MSG_IF (out.fail (), "Cannot write " << decimatedFile);
+  NS_LOG_INFO ("Decimated " << traceFile << ": " << decimation.nWaypoints << " waypoints to "
+               << decimation.nDecimated << ", error " << decimation.maxError << " m");
+  return decimation;
+}
+
+bool
+StealthTraceStore::IsCurrent (std::string binaryFile)
+{
+  std::ifstream in (binaryFile.c_str (), std::ios::binary);
+  char magic[8];
+  in.read (magic, 8);
+  return in.good () && std::memcmp (magic, "STLTRC02", 8) == 0;
+}
+
+void
+StealthTraceStore::Convert (std::string traceFile, std::string binaryFile, double keyframePeriod)
+{
+  NS_LOG_FUNCTION (traceFile << binaryFile << keyframePeriod);
+  NS_ABORT_MSG_UNLESS (keyframePeriod > 0, "Keyframe period must be positive");
+  std::ifstream in (traceFile.c_str ());
+  NS_ABORT_MSG_UNLESS (in.is_open (), "Cannot open trace " << traceFile);
+
+  std::vector<NodeEntry> nodes;
+  std::vector<std::vector<Waypoint> > waypoints;
+  std::string line;
+  while (std::getline (in, line))
+    {
+      unsigned int node;
+      char axis;
+      double value;
+      Waypoint w;
+      if (std::sscanf (line.c_str (), " $ns_ at %lf \"$node_(%u) setdest %lf %lf %lf",
+                       &w.time, &node, &w.x, &w.y, &w.speed) == 5)
+        {
+          if (node >= waypoints.size ())
+            {
+              waypoints.resize (node + 1);
+            }
+          waypoints[node].push_back (w);
+        }
+      else if (std::sscanf (line.c_str (), " $node_(%u) set %c_ %lf", &node, &axis, &value) == 3)
+        {
+          if (node >= nodes.size ())
+            {
+              NodeEntry empty;
+              std::memset (&empty, 0, sizeof (empty));
+              nodes.resize (node + 1, empty);
+            }
+          if (axis == 'X')
+            {
+              nodes[node].x = value;
+            }
+          else if (axis == 'Y')
+            {
+              nodes[node].y = value;
+            }
+          else if (axis == 'Z')
+            {
+              nodes[node].z = value;
+            }
+        }
+      else if (!line.empty ())
+        {
+          NS_LOG_WARN ("Ignoring trace line: " << line);
+        }
+    }
+
+  uint32_t nNodes = std::max (nodes.size (), waypoints.size ());
+  NS_ABORT_MSG_IF (nNodes == 0, "No node in trace " << traceFile);
+  NodeEntry empty;
+  std::memset (&empty, 0, sizeof (empty));
+  nodes.resize (nNodes, empty);
+  waypoints.resize (nNodes);
+  uint64_t nWaypoints = 0;
+  double last = 0;
+  for (uint32_t n = 0; n < nNodes; n++)
+    {
+      std::stable_sort (waypoints[n].begin (), waypoints[n].end (), WaypointBefore);
+      nodes[n].first = nWaypoints;
+      nodes[n].count = waypoints[n].size ();
+      nWaypoints += waypoints[n].size ();
+      if (!waypoints[n].empty ())
+        {
+          last = std::max (last, waypoints[n].back ().time);
+        }
+    }
+
+  // keyframe k holds the motion of every node at k * keyframePeriod
+  uint32_t nKeyframes = static_cast<uint32_t> (std::floor (last / keyframePeriod)) + 1;
+  std::vector<Motion> keyframes (nKeyframes * nNodes);
+  for (uint32_t n = 0; n < nNodes; n++)
+    {
+      Motion motion;
+      std::memset (&motion, 0, sizeof (motion));
+      motion.x = nodes[n].x;
+      motion.y = nodes[n].y;
+      const Waypoint *w = waypoints[n].empty () ? 0 : &waypoints[n][0];
+      for (uint32_t k = 0; k < nKeyframes; k++)
+        {
+          Advance (motion, w, waypoints[n].size (), k * keyframePeriod);
+          keyframes[k * nNodes + n] = motion;
+        }
+    }
+
+  FileHeader header;
+  std::memset (&header, 0, sizeof (header));
+  std::memcpy (header.magic, "STLTRC02", 8);
+  header.nNodes = nNodes;
+  header.nKeyframes = nKeyframes;
+  header.nWaypoints = nWaypoints;
+  header.keyframePeriod = keyframePeriod;
+
+  // write aside and rename, so that concurrent runs never map a partial file
+  std::ostringstream tmp;
+  tmp << binaryFile << "." << getpid ();
+  std::ofstream out (tmp.str ().c_str (), std::ios::binary);
+  NS_ABORT_MSG_UNLESS (out.is_open (), "Cannot write " << tmp.str ());
+  out.write (reinterpret_cast<const char *> (&header), sizeof (header));
+  out.write (reinterpret_cast<const char *> (&nodes[0]), nNodes * sizeof (NodeEntry));
+  for (uint32_t n = 0; n < nNodes; n++)
+    {
+      if (!waypoints[n].empty ())
+        {
+          out.write (reinterpret_cast<const char *> (&waypoints[n][0]),
+                     waypoints[n].size () * sizeof (Waypoint));
+        }
+    }
+  out.write (reinterpret_cast<const char *> (&keyframes[0]), keyframes.size () * sizeof (Motion));
+  out.close ();
+  NS_ABORT_MSG_IF (out.fail (), "Cannot write " << tmp.str ());
+  NS_ABORT_MSG_IF (std::rename (tmp.str ().c_str (), binaryFile.c_str ()) != 0,
+                   "Cannot rename " << tmp.str () << " to " << binaryFile);
+  NS_LOG_INFO ("Converted " << traceFile << ": " << nNodes << " nodes, " << nWaypoints << " waypoints, "
+               << nKeyframes << " keyframes");
+}
+
+StealthTraceStore::StealthTraceStore (std::string binaryFile)
+  : m_binaryFile (binaryFile)
+{
+  NS_LOG_FUNCTION (this << binaryFile);
+  int fd = open (binaryFile.c_str (), O_RDONLY);
+  NS_ABORT_MSG_IF (fd < 0, "Cannot open " << binaryFile);
+  struct stat st;
+  NS_ABORT_MSG_IF (fstat (fd, &st) != 0, "Cannot stat " << binaryFile);
+  m_mapSize = st.st_size;
+  NS_ABORT_MSG_IF (m_mapSize < sizeof (FileHeader), "Truncated " << binaryFile);
+  m_map = mmap (0, m_mapSize, PROT_READ, MAP_SHARED, fd, 0);
+  close (fd);
+  NS_ABORT_MSG_IF (m_map == MAP_FAILED, "Cannot map " << binaryFile);
+
+  const char *base = static_cast<const char *> (m_map);
+  m_header = reinterpret_cast<const FileHeader *> (base);
+  NS_ABORT_MSG_IF (std::memcmp (m_header->magic, "STLTRC02", 8) != 0, "Bad magic in " << binaryFile);
+  m_nodes = reinterpret_cast<const NodeEntry *> (base + sizeof (FileHeader));
+  m_waypoints = reinterpret_cast<const Waypoint *> (base + sizeof (FileHeader)
+                                                    + m_header->nNodes * sizeof (NodeEntry));
+  m_keyframes = reinterpret_cast<const Motion *> (m_waypoints + m_header->nWaypoints);
+  NS_ABORT_MSG_IF (reinterpret_cast<const char *> (m_keyframes + (uint64_t) m_header->nKeyframes * m_header->nNodes)
+                   > base + m_mapSize, "Truncated " << binaryFile);
+}
+
+StealthTraceStore::~StealthTraceStore ()
+{
+  NS_LOG_FUNCTION (this);
+  munmap (m_map, m_mapSize);
+  StoreRegistry &registry = GetStoreRegistry ();
+  StoreRegistry::iterator i = registry.find (m_binaryFile);
+  if (i != registry.end () && i->second == this)
+    {
+      registry.erase (i);
+    }
+}
+
+uint32_t
+StealthTraceStore::GetNNodes (void) const
+{
+  return m_header->nNodes;
+}
+
+Vector
+StealthTraceStore::GetInitialPosition (uint32_t node) const
+{
+  NS_ASSERT (node < m_header->nNodes);
+  return Vector (m_nodes[node].x, m_nodes[node].y, m_nodes[node].z);
+}
+
+uint32_t
+StealthTraceStore::GetNWaypoints (uint32_t node) const
+{
+  NS_ASSERT (node < m_header->nNodes);
+  return m_nodes[node].count;
+}
+
+const StealthTraceStore::Waypoint *
+StealthTraceStore::GetWaypoints (uint32_t node) const
+{
+  NS_ASSERT (node < m_header->nNodes);
+  return m_waypoints + m_nodes[node].first;
+}
+
+StealthTraceStore::Motion
+StealthTraceStore::Seek (uint32_t node, Time time) const
+{
+  NS_LOG_FUNCTION (this << node << time);
+  NS_ASSERT (node < m_header->nNodes);
+  double t = std::max (time.GetSeconds (), 0.0);
+  uint32_t k = std::min (static_cast<uint32_t> (std::floor (t / m_header->keyframePeriod)),
+                         m_header->nKeyframes - 1);
+  Motion motion = m_keyframes[(uint64_t) k * m_header->nNodes + node];
+  Advance (motion, GetWaypoints (node), GetNWaypoints (node), t);
+  return motion;
+}
+
+Vector
+StealthTraceStore::GetPosition (uint32_t node, Time time) const
+{
+  Motion motion = Seek (node, time);
+  return Vector (motion.x, motion.y, m_nodes[node].z);
+}
+
+Time
+StealthTraceStore::GetAppearanceTime (uint32_t node) const
+{
+  NS_ASSERT (node < m_header->nNodes);
+  if (GetNWaypoints (node) == 0)
+    {
+      return Seconds (0.0);
+    }
+  return Seconds (GetWaypoints (node)[0].time);
+}
+
+Time
+StealthTraceStore::GetDisappearanceTime (uint32_t node) const
+{
+  NS_ASSERT (node < m_header->nNodes);
+  uint32_t count = GetNWaypoints (node);
+  if (count == 0)
+    {
+      return Time::Max ();
+    }
+  double last = GetWaypoints (node)[count - 1].time;
+  Motion motion = Seek (node, Seconds (last));
+  // the time of the waypoint may not be exactly that of the Time seeked
+  Advance (motion, GetWaypoints (node), count, std::max (last, motion.since));
+  if (!motion.moving)
+    {
+      return Seconds (last);
+    }
+  double dx = motion.dx - motion.x;
+  double dy = motion.dy - motion.y;
+  return Seconds (last + std::sqrt (dx * dx + dy * dy) / motion.speed);
+}
+
+void
+StealthTraceStore::Advance (Motion &motion, const Waypoint *waypoints, uint32_t count, double time)
+{
+  for (;;)
+    {
+      bool apply = motion.next < count && waypoints[motion.next].time <= time;
+      double until = apply ? waypoints[motion.next].time : time;
+      if (motion.moving)
+        {
+          double dx = motion.dx - motion.x;
+          double dy = motion.dy - motion.y;
+          double distance = std::sqrt (dx * dx + dy * dy);
+          double traveled = motion.speed * (until - motion.since);
+          if (traveled >= distance)
+            {
+              motion.x = motion.dx;
+              motion.y = motion.dy;
+              motion.moving = 0;
+            }
+          else
+            {
+              motion.x += dx * traveled / distance;
+              motion.y += dy * traveled / distance;
+            }
+        }
+      motion.since = until;
+      if (!apply)
+        {
+          return;
+        }
+      const Waypoint &w = waypoints[motion.next++];
+      motion.dx = w.x;
+      motion.dy = w.y;
+      motion.speed = w.speed;
+      motion.moving = (w.speed > 0 && (w.x != motion.x || w.y != motion.y)) ? 1 : 0;
+    }
+}
+
+void
+StealthTraceStore::Install (void)
+{
+  NS_LOG_FUNCTION (this);
+  Install (NodeList::Begin (), NodeList::End ());
+}
+
+void
+StealthTraceStore::Install (std::vector<Ptr<Node> >::const_iterator begin,
+                            std::vector<Ptr<Node> >::const_iterator end,
+                            Time start)
+{
+  NS_LOG_FUNCTION (this << start);
+  uint32_t node = 0;
+  for (std::vector<Ptr<Node> >::const_iterator i = begin;
+       i != end && node < GetNNodes (); i++, node++)
+    {
+      Ptr<ConstantVelocityMobilityModel> model = (*i)->GetObject<ConstantVelocityMobilityModel> ();
+      if (model == 0)
+        {
+          model = CreateObject<ConstantVelocityMobilityModel> ();
+          (*i)->AggregateObject (model);
+        }
+      Ptr<StealthTraceCursor> cursor = Create<StealthTraceCursor> (Ptr<const StealthTraceStore> (this), node, model);
+      cursor->Start (start);
+    }
+}
+
+void
+StealthTraceStore::InstallLifecycle (std::vector<Ptr<Node> >::const_iterator begin,
+                                     std::vector<Ptr<Node> >::const_iterator end,
+                                     Time start)
+{
+  NS_LOG_FUNCTION (this << start);
+  Time now = Simulator::Now ();
+  uint32_t node = 0;
+  for (std::vector<Ptr<Node> >::const_iterator i = begin;
+       i != end && node < GetNNodes (); i++, node++)
+    {
+      Time appearance = GetAppearanceTime (node) - start;
+      Time disappearance = GetDisappearanceTime (node);
+      if (disappearance != Time::Max ())
+        {
+          disappearance = disappearance - start;
+        }
+
+      if (disappearance <= Seconds (0.0))
+        {
+          (*i)->SetActive (false);
+        }
+      else if (appearance > Seconds (0.0))
+        {
+          (*i)->SetActive (false);
+          Simulator::ScheduleWithContext ((*i)->GetId (), appearance, &Node::SetActive, *i, true);
+        }
+      if (disappearance > Seconds (0.0) && disappearance != Time::Max ())
+        {
+          Simulator::ScheduleWithContext ((*i)->GetId (), disappearance, &Node::SetActive, *i, false);
+        }
+
+      // applications run during the presence only
+      Time arrival = now + std::max (appearance, Seconds (0.0));
+      Time departure = disappearance == Time::Max () ? Time::Max () : now + disappearance;
+      for (uint32_t a = 0; a < (*i)->GetNApplications (); a++)
+        {
+          Ptr<Application> application = (*i)->GetApplication (a);
+          TimeValue startTime;
+          TimeValue stopTime;
+          application->GetAttribute ("StartTime", startTime);
+          application->GetAttribute ("StopTime", stopTime);
+          // a null stop time means never
+          Time stop = stopTime.Get ().IsZero () ? Time::Max () : stopTime.Get ();
+          Time from = std::max (startTime.Get (), arrival);
+          Time to = std::min (stop, departure);
+          if (from >= to)
+            {
+              // the application would only run while the node is away:
+              // its start is pushed past any simulation end, and it is
+              // never stopped since it never starts
+              application->SetStartTime (Time::Max () - now);
+              application->SetStopTime (Seconds (0.0));
+              continue;
+            }
+          application->SetStartTime (from);
+          if (to != Time::Max ())
+            {
+              application->SetStopTime (to);
+            }
+        }
+    }
+}
+
+StealthTraceCursor::StealthTraceCursor (Ptr<const StealthTraceStore> store, uint32_t node,
+                                        Ptr<ConstantVelocityMobilityModel> model)
+  : m_store (store),
+    m_model (model),
+    m_next (store->GetWaypoints (node)),
+    m_end (store->GetWaypoints (node) + store->GetNWaypoints (node)),
+    m_node (node)
+{
+}
+
+void
+StealthTraceCursor::Start (Time start)
+{
+  NS_LOG_FUNCTION (this << m_node << start);
+  m_offset = start - Simulator::Now ();
+  StealthTraceStore::Motion motion = m_store->Seek (m_node, start);
+  double z = m_store->GetInitialPosition (m_node).z;
+  m_model->SetPosition (Vector (motion.x, motion.y, z));
+  if (motion.moving)
+    {
+      double dx = motion.dx - motion.x;
+      double dy = motion.dy - motion.y;
+      double distance = std::sqrt (dx * dx + dy * dy);
+      double k = motion.speed / distance;
+      m_model->SetVelocity (Vector (k * dx, k * dy, 0));
+      m_arrival = Simulator::Schedule (Seconds (distance / motion.speed),
+                                       &StealthTraceCursor::Arrive, Ptr<StealthTraceCursor> (this),
+                                       Vector (motion.dx, motion.dy, z));
+    }
+  else
+    {
+      m_model->SetVelocity (Vector (0, 0, 0));
+    }
+  m_next += motion.next;
+  ScheduleNext ();
+}
+
+void
+StealthTraceCursor::ScheduleNext (void)
+{
+  if (m_next == m_end)
+    {
+      return;
+    }
+  Time at = Seconds (m_next->time) - m_offset;
+  Time now = Simulator::Now ();
+  // the pending event holds a reference: the cursor lives as long as it has waypoints
+  Simulator::Schedule (at > now ? at - now : Seconds (0.0), &StealthTraceCursor::Step,
+                       Ptr<StealthTraceCursor> (this));
+}
+
+void
+StealthTraceCursor::Step (void)
+{
+  NS_LOG_FUNCTION (this << m_node);
+  m_arrival.Cancel ();
+  Vector position = m_model->GetPosition ();
+  Vector destination (m_next->x, m_next->y, position.z);
+  double distance = CalculateDistance (position, destination);
+  if (m_next->speed > 0 && distance > 0)
+    {
+      double k = m_next->speed / distance;
+      m_model->SetVelocity (Vector (k * (destination.x - position.x),
+                                    k * (destination.y - position.y), 0));
+      m_arrival = Simulator::Schedule (Seconds (distance / m_next->speed),
+                                       &StealthTraceCursor::Arrive, Ptr<StealthTraceCursor> (this),
+                                       destination);
+    }
+  else
+    {
+      m_model->SetVelocity (Vector (0, 0, 0));
+    }
+  m_next++;
+  ScheduleNext ();
+}
+
+void
+StealthTraceCursor::Arrive (Vector destination)
+{
+  NS_LOG_FUNCTION (this << m_node);
+  m_model->SetVelocity (Vector (0, 0, 0));
+  m_model->SetPosition (destination);
+}
+
+} // namespace ns3
@@ -0,0 +1,313 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * STEALTH Project (2019)
+ */
+
+#ifndef STEALTH_TRACE_STORE_H
+#define STEALTH_TRACE_STORE_H
+
+#include <string>
+#include <vector>
+
+#include "ns3/ptr.h"
+#include "ns3/simple-ref-count.h"
+#include "ns3/vector.h"
+#include "ns3/event-id.h"
+#include "ns3/node.h"
+
+namespace ns3 {
+
+class ConstantVelocityMobilityModel;
+
+/**
+ * \ingroup mobility
+ *
+ * \brief Shared, read-only store of an ns-2 mobility trace.
+ *
+ * The first Open of a trace parses it once into a compact binary file
+ * (the trace name with a ".bin" suffix), rebuilt whenever the trace is
+ * newer. The binary file is memory-mapped read-only: every simulation
+ * opening the same trace in this process gets the same store, and
+ * simulations running in other processes of the host share its pages
+ * through the page cache. Each simulation only holds its own cursors.
+ *
+ * Waypoints are grouped by node and sorted by time. A waypoint is an
+ * ns-2 "setdest": at its time the node starts moving toward (x, y) at
+ * the given speed, and stops there.
+ *
+ * Since the position of a node depends on all its previous waypoints, the
+ * file also holds keyframes: the motion state of every node at multiples
+ * of a keyframe period. Seeking to a time starts from the keyframe at or
+ * before it, found in constant time, and replays at most one period of
+ * waypoints, so a run can start at any trace time without replaying the
+ * trace from 0.
+ */
+class StealthTraceStore : public SimpleRefCount<StealthTraceStore>
+{
+public:
+  /// An ns-2 setdest command
+  struct Waypoint
+  {
+    double time;   //!< start time, in seconds
+    double x;      //!< destination x
+    double y;      //!< destination y
+    double speed;  //!< speed, in m/s
+  };
+
+  /// Motion state of a node
+  struct Motion
+  {
+    double x;         //!< current x
+    double y;         //!< current y
+    double dx;        //!< destination x
+    double dy;        //!< destination y
+    double speed;     //!< speed toward the destination, in m/s
+    double since;     //!< time of the current position, in seconds
+    uint32_t next;    //!< index of the next waypoint of the node
+    uint32_t moving;  //!< 1 if the node is moving toward the destination
+  };
+
+  /// Outcome of Decimate
+  struct Decimation
+  {
+    uint64_t nWaypoints;   //!< waypoints of the original trace
+    uint64_t nDecimated;   //!< waypoints of the decimated trace
+    double maxError;       //!< largest distance between a node and its decimated replay at the same time, in meters
+  };
+
+  /**
+   * \param traceFile the ns-2 mobility trace
+   * \param keyframePeriod the period of the keyframes, in seconds. It
+   *        only applies when the binary file is (re)built.
+   * \returns the store of that trace, shared with every other user
+   */
+  static Ptr<StealthTraceStore> Open (std::string traceFile, double keyframePeriod = 10.0);
+  /**
+   * \param traceFile the ns-2 mobility trace
+   * \param decimatedFile the ns-2 mobility trace to write
+   * \param maxError the largest position error allowed, in meters
+   * \returns the waypoints before and after, and the error reached
+   *
+   * Merge the consecutive waypoints of each node whose path is well
+   * approximated by a single straight move at constant speed, e.g. a
+   * pedestrian walking along a street, so that replaying the decimated
+   * trace schedules far fewer course changes. The path of a node is
+   * simplified in space-time with Douglas-Peucker: a node of the
+   * decimated trace is never farther than maxError from where it is in
+   * the original trace at the same time. Nodes keep their initial
+   * position, appearance and disappearance times.
+   */
+  static Decimation Decimate (std::string traceFile, std::string decimatedFile, double maxError);
+
+  ~StealthTraceStore ();
+
+  /**
+   * \returns the number of nodes of the trace
+   */
+  uint32_t GetNNodes (void) const;
+  /**
+   * \param node a node index
+   * \returns the position of the node before its first waypoint
+   */
+  Vector GetInitialPosition (uint32_t node) const;
+  /**
+   * \param node a node index
+   * \returns the number of waypoints of the node
+   */
+  uint32_t GetNWaypoints (uint32_t node) const;
+  /**
+   * \param node a node index
+   * \returns the waypoints of the node, valid as long as the store is alive
+   */
+  const Waypoint *GetWaypoints (uint32_t node) const;
+
+  /**
+   * \param node a node index
+   * \param time a trace time
+   * \returns the motion state of the node at that time, computed from
+   *          the keyframe at or before it
+   */
+  Motion Seek (uint32_t node, Time time) const;
+  /**
+   * \param node a node index
+   * \param time a trace time
+   * \returns the position of the node at that time
+   */
+  Vector GetPosition (uint32_t node, Time time) const;
+  /**
+   * \param node a node index
+   * \returns the trace time the node appears, that of its first
+   *          waypoint, or zero if it has none
+   */
+  Time GetAppearanceTime (uint32_t node) const;
+  /**
+   * \param node a node index
+   * \returns the trace time the node leaves, when it reaches the
+   *          destination of its last waypoint, or Time::Max () if it
+   *          has no waypoint
+   */
+  Time GetDisappearanceTime (uint32_t node) const;
+
+  /**
+   * \param motion a motion state
+   * \param waypoints the waypoints of the node
+   * \param count the number of waypoints of the node
+   * \param time a time not before motion.since, in seconds
+   *
+   * Apply the waypoints up to the given time and move the node there.
+   */
+  static void Advance (Motion &motion, const Waypoint *waypoints, uint32_t count, double time);
+
+  /**
+   * \brief Drive the mobility of the first GetNNodes () nodes of NodeList.
+   *
+   * Like Ns2MobilityHelper::Install, a ConstantVelocityMobilityModel is
+   * aggregated to nodes without one. Only the next waypoint of each node
+   * is scheduled at any time.
+   */
+  void Install (void);
+  /**
+   * \param begin first node of the range
+   * \param end past the last node of the range
+   * \param start the trace time matching the current simulation time
+   *
+   * Drive the mobility of a range of nodes, the n-th node of the range
+   * following the n-th node of the trace. Nodes resume from their exact
+   * position and motion at the start time, e.g. Seconds (600) to begin
+   * a run 600 s into the trace, or Simulator::Now () when restoring a
+   * checkpoint.
+   */
+  void Install (std::vector<Ptr<Node> >::const_iterator begin,
+                std::vector<Ptr<Node> >::const_iterator end,
+                Time start = Seconds (0.0));
+  /**
+   * \param begin first node of the range
+   * \param end past the last node of the range
+   * \param start the trace time matching the current simulation time
+   *
+   * Keep each node of a range dormant (Node::SetActive) outside its
+   * presence in the trace, from its appearance to its disappearance,
+   * the n-th node of the range following the n-th node of the trace.
+   * The start and stop times of the applications installed on the
+   * nodes are narrowed to the presence, so that no hello timer runs
+   * while a node is away. An application whose run does not overlap
+   * the presence is never started. Call it after installing the
+   * applications and before Simulator::Run.
+   */
+  void InstallLifecycle (std::vector<Ptr<Node> >::const_iterator begin,
+                         std::vector<Ptr<Node> >::const_iterator end,
+                         Time start = Seconds (0.0));
+
+private:
+  /// Binary file header
+  struct FileHeader
+  {
+    char magic[8];          //!< "STLTRC02"
+    uint32_t nNodes;        //!< number of nodes
+    uint32_t nKeyframes;    //!< number of keyframes
+    uint64_t nWaypoints;    //!< number of waypoints
+    double keyframePeriod;  //!< keyframe period, in seconds
+  };
+
+  /// Binary file node entry
+  struct NodeEntry
+  {
+    uint64_t first;      //!< index of the first waypoint
+    uint32_t count;      //!< number of waypoints
+    uint32_t reserved;   //!< padding
+    double x;            //!< initial x
+    double y;            //!< initial y
+    double z;            //!< initial z
+  };
+
+  /**
+   * \param binaryFile the binary file to map
+   */
+  StealthTraceStore (std::string binaryFile);
+
+  /**
+   * \param traceFile the ns-2 mobility trace to parse
+   * \param binaryFile the binary file to write
+   * \param keyframePeriod the period of the keyframes, in seconds
+   */
+  static void Convert (std::string traceFile, std::string binaryFile, double keyframePeriod);
+  /**
+   * \param binaryFile a binary file
+   * \returns true if the file exists and has the current format
+   */
+  static bool IsCurrent (std::string binaryFile);
+
+  std::string m_binaryFile;      //!< path of the mapped file
+  void *m_map;                   //!< mapped file
+  uint64_t m_mapSize;            //!< size of the mapping
+  const FileHeader *m_header;    //!< header in the mapping
+  const NodeEntry *m_nodes;      //!< node entries in the mapping
+  const Waypoint *m_waypoints;   //!< waypoints in the mapping
+  const Motion *m_keyframes;     //!< keyframes in the mapping, by time then node
+};
+
+/**
+ * \ingroup mobility
+ *
+ * \brief Per-simulation cursor replaying one node of a StealthTraceStore.
+ */
+class StealthTraceCursor : public SimpleRefCount<StealthTraceCursor>
+{
+public:
+  /**
+   * \param store the trace store
+   * \param node the node index in the trace
+   * \param model the mobility model to drive
+   */
+  StealthTraceCursor (Ptr<const StealthTraceStore> store, uint32_t node,
+                      Ptr<ConstantVelocityMobilityModel> model);
+
+  /**
+   * \param start the trace time matching the current simulation time
+   *
+   * Seek to the start time, set the position and velocity of the node
+   * there and schedule the next waypoint.
+   */
+  void Start (Time start);
+
+private:
+  /**
+   * \brief Apply the current waypoint and schedule the next one.
+   */
+  void Step (void);
+  /**
+   * \param destination the waypoint destination
+   *
+   * Stop the node on arrival.
+   */
+  void Arrive (Vector destination);
+  /**
+   * \brief Schedule the current waypoint, if any.
+   */
+  void ScheduleNext (void);
+
+  Ptr<const StealthTraceStore> m_store;          //!< the trace store
+  Ptr<ConstantVelocityMobilityModel> m_model;    //!< the driven model
+  const StealthTraceStore::Waypoint *m_next;     //!< current waypoint
+  const StealthTraceStore::Waypoint *m_end;      //!< past the last waypoint
+  uint32_t m_node;                               //!< node index in the trace
+  Time m_offset;                                 //!< trace time minus simulation time
+  EventId m_arrival;                             //!< pending arrival event
+};
+
+} // namespace ns3
+
+#endif /* STEALTH_TRACE_STORE_H */
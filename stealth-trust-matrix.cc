@@ -0,0 +1,172 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * STEALTH Project (2019)
+ */
+
+#include <algorithm>
+
+#include "stealth-trust-matrix.h"
+#include "ns3/log.h"
+#include "ns3/assert.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("StealthTrustMatrix");
+
+namespace {
+
+/// Lookup of a row by reporter
+struct RowBefore
+{
+  template <typename R>
+  bool operator() (const R &row, uint32_t reporter) const
+  {
+    return row.reporter < reporter;
+  }
+};
+
+/// Lookup of a column by subject
+struct ColumnBefore
+{
+  template <typename C>
+  bool operator() (const C &column, uint32_t subject) const
+  {
+    return column.subject < subject;
+  }
+};
+
+/// Equality of reports
+struct SameReport
+{
+  template <typename R>
+  bool operator() (const R &a, const R &b) const
+  {
+    return a.subject == b.subject && a.trust == b.trust;
+  }
+};
+
+} // anonymous namespace
+
+bool
+StealthTrustMatrix::SetRow (uint32_t reporter, const std::vector<Report> &reports)
+{
+  NS_LOG_FUNCTION (this << reporter << reports.size ());
+  NS_ASSERT_MSG (reports.size () <= StealthHeader::MAX_TRUST_REPORTS,
+                 "Too many trust reports from " << reporter);
+  std::vector<Row>::iterator i = std::lower_bound (m_rows.begin (), m_rows.end (), reporter, RowBefore ());
+  if (i == m_rows.end () || i->reporter != reporter)
+    {
+      Row row;
+      row.reporter = reporter;
+      row.count = 0;
+      i = m_rows.insert (i, row);
+    }
+  else
+    {
+      if (i->count == reports.size () && std::equal (reports.begin (), reports.end (), i->reports, SameReport ()))
+        {
+          return false;
+        }
+      UpdateColumns (*i, -1);
+    }
+  i->count = reports.size ();
+  std::copy (reports.begin (), reports.end (), i->reports);
+  UpdateColumns (*i, 1);
+  return true;
+}
+
+bool
+StealthTrustMatrix::RemoveRow (uint32_t reporter)
+{
+  NS_LOG_FUNCTION (this << reporter);
+  std::vector<Row>::iterator i = std::lower_bound (m_rows.begin (), m_rows.end (), reporter, RowBefore ());
+  if (i == m_rows.end () || i->reporter != reporter)
+    {
+      return false;
+    }
+  UpdateColumns (*i, -1);
+  m_rows.erase (i);
+  return true;
+}
+
+void
+StealthTrustMatrix::Clear (void)
+{
+  NS_LOG_FUNCTION (this);
+  std::vector<Row> ().swap (m_rows);
+  std::vector<Column> ().swap (m_columns);
+}
+
+void
+StealthTrustMatrix::UpdateColumns (const Row &row, int sign)
+{
+  for (uint32_t r = 0; r < row.count; r++)
+    {
+      const Report &report = row.reports[r];
+      std::vector<Column>::iterator i = std::lower_bound (m_columns.begin (), m_columns.end (),
+                                                          report.subject, ColumnBefore ());
+      if (i == m_columns.end () || i->subject != report.subject)
+        {
+          NS_ASSERT (sign > 0);
+          Column column;
+          column.subject = report.subject;
+          column.count = 0;
+          column.sum = 0;
+          i = m_columns.insert (i, column);
+        }
+      i->count += sign;
+      i->sum += sign * report.trust;
+      if (i->count == 0)
+        {
+          m_columns.erase (i);
+        }
+    }
+}
+
+bool
+StealthTrustMatrix::GetReputation (uint32_t subject, double &trust) const
+{
+  std::vector<Column>::const_iterator i = std::lower_bound (m_columns.begin (), m_columns.end (),
+                                                            subject, ColumnBefore ());
+  if (i == m_columns.end () || i->subject != subject)
+    {
+      return false;
+    }
+  trust = i->sum / i->count;
+  return true;
+}
+
+uint32_t
+StealthTrustMatrix::GetNReports (uint32_t subject) const
+{
+  std::vector<Column>::const_iterator i = std::lower_bound (m_columns.begin (), m_columns.end (),
+                                                            subject, ColumnBefore ());
+  return i != m_columns.end () && i->subject == subject ? i->count : 0;
+}
+
+uint32_t
+StealthTrustMatrix::GetNRows (void) const
+{
+  return m_rows.size ();
+}
+
+uint64_t
+StealthTrustMatrix::GetMemoryUsage (void) const
+{
+  return m_rows.capacity () * sizeof (Row) + m_columns.capacity () * sizeof (Column);
+}
+
+} // namespace ns3
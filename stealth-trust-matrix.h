@@ -0,0 +1,121 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * STEALTH Project (2019)
+ */
+
+#ifndef STEALTH_TRUST_MATRIX_H
+#define STEALTH_TRUST_MATRIX_H
+
+#include <vector>
+
+#include "ns3/stealth-header.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup network
+ *
+ * \brief Sparse matrix of the trust reports gossiped by other nodes.
+ *
+ * Row r holds the last trust summary received from reporter r: at most
+ * StealthHeader::MAX_TRUST_REPORTS (subject, trust) entries, stored inline
+ * so that the whole matrix is one contiguous vector of rows sorted by
+ * reporter. Column aggregates (sum and count of the reports about each
+ * subject) are kept up to date on every row change, so the reputation of
+ * a node is found by a binary search instead of a column scan. Memory is
+ * O(reporters + subjects), not O(n^2).
+ */
+class StealthTrustMatrix
+{
+public:
+  /// A trust report
+  struct Report
+  {
+    uint32_t subject;   //!< id of the node the report is about
+    float trust;        //!< reported trust, in [0,1]
+  };
+
+  /**
+   * \param reporter the id of the reporting node
+   * \param reports its reports, at most StealthHeader::MAX_TRUST_REPORTS
+   *
+   * \returns false if the row already held those reports
+   *
+   * Replace the row of the reporter.
+   */
+  bool SetRow (uint32_t reporter, const std::vector<Report> &reports);
+  /**
+   * \param reporter the id of a reporting node
+   * \returns false if the reporter had no row
+   *
+   * Forget the reports of the reporter.
+   */
+  bool RemoveRow (uint32_t reporter);
+  /**
+   * \brief Forget every report and free the storage.
+   */
+  void Clear (void);
+
+  /**
+   * \param subject a node id
+   * \param trust receives the mean trust reported about the node
+   * \returns false if no report is about the node
+   */
+  bool GetReputation (uint32_t subject, double &trust) const;
+  /**
+   * \param subject a node id
+   * \returns the number of reports about the node
+   */
+  uint32_t GetNReports (uint32_t subject) const;
+  /**
+   * \returns the number of reporters
+   */
+  uint32_t GetNRows (void) const;
+  /**
+   * \returns the bytes allocated on the heap by the matrix
+   */
+  uint64_t GetMemoryUsage (void) const;
+
+private:
+  /// The reports of one reporter
+  struct Row
+  {
+    uint32_t reporter;                                    //!< reporter id
+    uint32_t count;                                       //!< number of reports
+    Report reports[StealthHeader::MAX_TRUST_REPORTS];     //!< the reports
+  };
+
+  /// Aggregate of the reports about one subject
+  struct Column
+  {
+    uint32_t subject;   //!< subject id
+    uint32_t count;     //!< number of reports
+    double sum;         //!< sum of the reported trusts
+  };
+
+  /**
+   * \param row a row whose reports are added or withdrawn
+   * \param sign 1 to add the reports, -1 to withdraw them
+   */
+  void UpdateColumns (const Row &row, int sign);
+
+  std::vector<Row> m_rows;         //!< rows, by reporter
+  std::vector<Column> m_columns;   //!< column aggregates, by subject
+};
+
+} // namespace ns3
+
+#endif /* STEALTH_TRUST_MATRIX_H */
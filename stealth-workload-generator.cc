@@ -0,0 +1,259 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * STEALTH Project (2019)
+ */
+
+#include <algorithm>
+#include <utility>
+
+#include "stealth-workload-generator.h"
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/simulator.h"
+#include "ns3/mobility-model.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("StealthWorkloadGenerator");
+
+StealthWorkloadGenerator::StealthWorkloadGenerator (std::vector<Ptr<Node> >::const_iterator begin,
+                                                    std::vector<Ptr<Node> >::const_iterator end)
+  : m_nodes (begin, end),
+    m_recovery (Seconds (0.0)),
+    m_started (false),
+    m_nEmergencies (0)
+{
+  NS_LOG_FUNCTION (this << m_nodes.size ());
+  m_interarrival = CreateObject<ExponentialRandomVariable> ();
+  m_pick = CreateObject<UniformRandomVariable> ();
+}
+
+void
+StealthWorkloadGenerator::SetEmergencyCallback (EmergencyCallback callback)
+{
+  m_callback = callback;
+}
+
+void
+StealthWorkloadGenerator::SetRecoveryTime (Time recovery)
+{
+  m_recovery = recovery;
+}
+
+void
+StealthWorkloadGenerator::AddPoisson (double rate, Time start, Time stop)
+{
+  NS_LOG_FUNCTION (this << rate << start << stop);
+  NS_ASSERT_MSG (rate > 0, "Poisson rate must be positive");
+  Poisson process;
+  process.rate = rate;
+  process.stop = stop;
+  m_poisson.push_back (process);
+  PushPoisson (m_poisson.size () - 1, start);
+}
+
+void
+StealthWorkloadGenerator::AddBurst (Time at, Vector center, double radius, uint32_t count)
+{
+  NS_LOG_FUNCTION (this << at << radius << count);
+  Burst burst;
+  burst.center = center;
+  burst.radius = radius;
+  burst.count = count;
+  m_bursts.push_back (burst);
+  Arrival arrival;
+  arrival.at = at;
+  arrival.kind = BURST;
+  arrival.index = m_bursts.size () - 1;
+  Push (arrival);
+}
+
+void
+StealthWorkloadGenerator::Start (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_started = true;
+  ScheduleNext ();
+}
+
+uint32_t
+StealthWorkloadGenerator::GetNEmergencies (void) const
+{
+  return m_nEmergencies;
+}
+
+void
+StealthWorkloadGenerator::Push (const Arrival &arrival)
+{
+  m_queue.push (arrival);
+  if (m_started)
+    {
+      ScheduleNext ();
+    }
+}
+
+void
+StealthWorkloadGenerator::PushPoisson (uint32_t process, Time from)
+{
+  const Poisson &poisson = m_poisson[process];
+  Arrival arrival;
+  arrival.at = from + Seconds (m_interarrival->GetValue (1.0 / poisson.rate, 0));
+  arrival.kind = POISSON;
+  arrival.index = process;
+  if (arrival.at < poisson.stop)
+    {
+      Push (arrival);
+    }
+}
+
+void
+StealthWorkloadGenerator::ScheduleNext (void)
+{
+  if (m_queue.empty ())
+    {
+      return;
+    }
+  Time at = m_queue.top ().at;
+  if (m_event.IsRunning ())
+    {
+      if (m_eventTime <= at)
+        {
+          return;
+        }
+      m_event.Cancel ();
+    }
+  Time now = Simulator::Now ();
+  m_eventTime = std::max (at, now);
+  m_event = Simulator::Schedule (m_eventTime - now, &StealthWorkloadGenerator::Fire,
+                                 Ptr<StealthWorkloadGenerator> (this));
+}
+
+void
+StealthWorkloadGenerator::Fire (void)
+{
+  NS_LOG_FUNCTION (this);
+  Time now = Simulator::Now ();
+  while (!m_queue.empty () && m_queue.top ().at <= now)
+    {
+      Arrival arrival = m_queue.top ();
+      m_queue.pop ();
+      switch (arrival.kind)
+        {
+        case POISSON:
+          {
+            uint32_t index;
+            if (PickNormalNode (index))
+              {
+                Trigger (index);
+              }
+            PushPoisson (arrival.index, arrival.at);
+            break;
+          }
+        case BURST:
+          TriggerBurst (m_bursts[arrival.index]);
+          break;
+        case RECOVERY:
+          if (m_nodes[arrival.index]->GetStatus ())
+            {
+              NS_LOG_LOGIC ("Node " << m_nodes[arrival.index]->GetId () << " recovers");
+              m_nodes[arrival.index]->SetStatus (false);
+            }
+          break;
+        }
+    }
+  ScheduleNext ();
+}
+
+void
+StealthWorkloadGenerator::Trigger (uint32_t index)
+{
+  Ptr<Node> node = m_nodes[index];
+  NS_LOG_LOGIC ("Node " << node->GetId () << " enters emergency");
+  node->SetStatus (true);
+  m_nEmergencies++;
+  if (!m_recovery.IsZero ())
+    {
+      Arrival arrival;
+      arrival.at = Simulator::Now () + m_recovery;
+      arrival.kind = RECOVERY;
+      arrival.index = index;
+      Push (arrival);
+    }
+  if (!m_callback.IsNull ())
+    {
+      m_callback (node);
+    }
+}
+
+void
+StealthWorkloadGenerator::TriggerBurst (const Burst &burst)
+{
+  NS_LOG_FUNCTION (this << burst.radius << burst.count);
+  std::vector<std::pair<double, uint32_t> > hit;
+  for (uint32_t i = 0; i < m_nodes.size (); i++)
+    {
+      Ptr<MobilityModel> mobility = m_nodes[i]->GetObject<MobilityModel> ();
+      if (mobility == 0 || m_nodes[i]->GetStatus () || !m_nodes[i]->IsActive ())
+        {
+          continue;
+        }
+      double distance = CalculateDistance (mobility->GetPosition (), burst.center);
+      if (distance <= burst.radius)
+        {
+          hit.push_back (std::make_pair (distance, i));
+        }
+    }
+  uint32_t count = std::min<uint32_t> (burst.count, hit.size ());
+  std::partial_sort (hit.begin (), hit.begin () + count, hit.end ());
+  for (uint32_t i = 0; i < count; i++)
+    {
+      Trigger (hit[i].second);
+    }
+}
+
+bool
+StealthWorkloadGenerator::PickNormalNode (uint32_t &index)
+{
+  if (m_nodes.empty ())
+    {
+      return false;
+    }
+  // a few random draws are enough while most nodes are in Normal status
+  for (uint32_t attempt = 0; attempt < 8; attempt++)
+    {
+      index = m_pick->GetInteger (0, m_nodes.size () - 1);
+      if (!m_nodes[index]->GetStatus () && m_nodes[index]->IsActive ())
+        {
+          return true;
+        }
+    }
+  std::vector<uint32_t> normal;
+  for (uint32_t i = 0; i < m_nodes.size (); i++)
+    {
+      if (!m_nodes[i]->GetStatus () && m_nodes[i]->IsActive ())
+        {
+          normal.push_back (i);
+        }
+    }
+  if (normal.empty ())
+    {
+      return false;
+    }
+  index = normal[m_pick->GetInteger (0, normal.size () - 1)];
+  return true;
+}
+
+} // namespace ns3
@@ -0,0 +1,198 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * STEALTH Project (2019)
+ */
+
+#ifndef STEALTH_WORKLOAD_GENERATOR_H
+#define STEALTH_WORKLOAD_GENERATOR_H
+
+#include <vector>
+#include <queue>
+
+#include "ns3/ptr.h"
+#include "ns3/simple-ref-count.h"
+#include "ns3/callback.h"
+#include "ns3/vector.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/node.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup mobility
+ *
+ * \brief Generator of emergencies over a population of nodes.
+ *
+ * Emergencies arrive following Poisson processes, each node in Normal
+ * status being equally likely to be hit, and bursts: at a given time, the
+ * nodes nearest to a location (from their mobility model, e.g. driven by
+ * a trace) become emergencies at once, as in a mass-casualty incident.
+ * Each emergency switches the node status to Emergency with
+ * Node::SetStatus and invokes the emergency callback, which typically
+ * sends the emergency request. With a recovery time, the node returns to
+ * Normal status that long after. Dormant nodes (Node::IsActive) are
+ * never hit.
+ *
+ * Arrivals, bursts and recoveries wait in a single time-ordered queue:
+ * only the earliest one is scheduled in the simulator, whatever the
+ * number of nodes and processes.
+ */
+class StealthWorkloadGenerator : public SimpleRefCount<StealthWorkloadGenerator>
+{
+public:
+  /// Invoked with each node entering Emergency status
+  typedef Callback<void, Ptr<Node> > EmergencyCallback;
+
+  /**
+   * \param begin first node of the population
+   * \param end past the last node of the population
+   */
+  StealthWorkloadGenerator (std::vector<Ptr<Node> >::const_iterator begin,
+                            std::vector<Ptr<Node> >::const_iterator end);
+
+  /**
+   * \param callback invoked with each node entering Emergency status
+   */
+  void SetEmergencyCallback (EmergencyCallback callback);
+  /**
+   * \param recovery the time after which an emergency node returns to
+   *        Normal status, zero (the default) to keep it in Emergency
+   */
+  void SetRecoveryTime (Time recovery);
+
+  /**
+   * \param rate the mean number of emergencies per second
+   * \param start the start of the process
+   * \param stop the end of the process
+   */
+  void AddPoisson (double rate, Time start, Time stop);
+  /**
+   * \param at the time of the burst
+   * \param center the location of the incident
+   * \param radius the distance from the location within which nodes may be hit
+   * \param count the number of nodes hit, the nearest first
+   */
+  void AddBurst (Time at, Vector center, double radius, uint32_t count);
+
+  /**
+   * \brief Schedule the first emergency. Processes and bursts may still
+   * be added afterwards.
+   */
+  void Start (void);
+
+  /**
+   * \returns the number of emergencies generated so far
+   */
+  uint32_t GetNEmergencies (void) const;
+
+private:
+  /// Kinds of queued events
+  enum Kind
+  {
+    POISSON,    //!< next arrival of a Poisson process
+    BURST,      //!< a burst
+    RECOVERY    //!< a node recovers
+  };
+
+  /// A queued event
+  struct Arrival
+  {
+    Time at;          //!< event time
+    Kind kind;        //!< event kind
+    uint32_t index;   //!< process, burst or node index
+  };
+
+  /// Orders the queue by increasing time
+  struct Later
+  {
+    /**
+     * \param a an event
+     * \param b another event
+     * \returns true if a comes after b
+     */
+    bool operator() (const Arrival &a, const Arrival &b) const
+    {
+      return a.at > b.at;
+    }
+  };
+
+  /// A Poisson process
+  struct Poisson
+  {
+    double rate;  //!< emergencies per second
+    Time stop;    //!< end of the process
+  };
+
+  /// A burst
+  struct Burst
+  {
+    Vector center;    //!< incident location
+    double radius;    //!< hit radius
+    uint32_t count;   //!< number of nodes hit
+  };
+
+  /**
+   * \param arrival an event to queue
+   */
+  void Push (const Arrival &arrival);
+  /**
+   * \param process a Poisson process index
+   * \param from the time of the previous arrival
+   *
+   * Queue the next arrival of the process, if before its end.
+   */
+  void PushPoisson (uint32_t process, Time from);
+  /**
+   * \brief Schedule the earliest queued event, if not already scheduled.
+   */
+  void ScheduleNext (void);
+  /**
+   * \brief Handle every queued event due now.
+   */
+  void Fire (void);
+  /**
+   * \param index the index of the node hit
+   */
+  void Trigger (uint32_t index);
+  /**
+   * \param burst the burst to apply
+   */
+  void TriggerBurst (const Burst &burst);
+  /**
+   * \param index receives the index of a random active node in Normal status
+   * \returns false if every active node is in Emergency status
+   */
+  bool PickNormalNode (uint32_t &index);
+
+  std::vector<Ptr<Node> > m_nodes;                 //!< the population
+  std::vector<Poisson> m_poisson;                  //!< Poisson processes
+  std::vector<Burst> m_bursts;                     //!< bursts
+  std::priority_queue<Arrival, std::vector<Arrival>, Later> m_queue; //!< pending events
+  Ptr<ExponentialRandomVariable> m_interarrival;   //!< Poisson inter-arrival times
+  Ptr<UniformRandomVariable> m_pick;               //!< Poisson node choices
+  EmergencyCallback m_callback;                    //!< emergency callback
+  Time m_recovery;                                 //!< recovery time, zero if none
+  EventId m_event;                                 //!< the scheduled event
+  Time m_eventTime;                                //!< time of the scheduled event
+  bool m_started;                                  //!< Start was called
+  uint32_t m_nEmergencies;                         //!< emergencies generated
+};
+
+} // namespace ns3
+
+#endif /* STEALTH_WORKLOAD_GENERATOR_H */